@@ -0,0 +1,735 @@
+/* libtutor.c — раскладка, поиск, строки экрана и просмотрщик секций.
+   Глобального состояния нет: всё — в аргументах и TutorView. */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "libtutor.h"
+
+/* ══════════════════════════════════════════════════════════════════════
+   UTF-8
+   ══════════════════════════════════════════════════════════════════════ */
+
+/* декодирует один символ, *s сдвигается за него; битые байты → U+FFFD */
+int tv_utf8_next(const char **s) {
+  const unsigned char *p = (const unsigned char *)*s;
+  int cp = *p++;
+  int n = 0;
+  if (cp >= 0xf0)
+    n = 3, cp &= 0x07;
+  else if (cp >= 0xe0)
+    n = 2, cp &= 0x0f;
+  else if (cp >= 0xc0)
+    n = 1, cp &= 0x1f;
+  else if (cp >= 0x80)
+    cp = 0xfffd;
+  while (n-- > 0) {
+    if ((*p & 0xc0) != 0x80) {
+      cp = 0xfffd;
+      break;
+    }
+    cp = (cp << 6) | (*p++ & 0x3f);
+  }
+  *s = (const char *)p;
+  return cp;
+}
+
+int tv_utf8_put(char *out, int cp) {
+  if (cp < 0x80) {
+    out[0] = (char)cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    out[0] = (char)(0xc0 | (cp >> 6));
+    out[1] = (char)(0x80 | (cp & 0x3f));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    out[0] = (char)(0xe0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+    out[2] = (char)(0x80 | (cp & 0x3f));
+    return 3;
+  }
+  out[0] = (char)(0xf0 | (cp >> 18));
+  out[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+  out[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+  out[3] = (char)(0x80 | (cp & 0x3f));
+  return 4;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   РАСКЛАДКА ЙЦУКЕН ↔ QWERTY
+   Одна и та же физическая клавиша: "й" ↔ "q", "ж" ↔ ";", "ё" ↔ "`".
+   Таблицы постоянные (раньше заполнялись при старте), по парам
+     qwertyuiop[]asdfghjkl;'zxcvbnm,.`  QWERTYUIOP{}ASDFGHJKL:"ZXCVBNM<>~
+     йцукенгшщзхъфывапролджэячсмитьбюё  ЙЦУКЕНГШЩЗХЪФЫВАПРОЛДЖЭЯЧСМИТЬБЮЁ
+   ══════════════════════════════════════════════════════════════════════ */
+
+static const unsigned char cyr2lat[0x60] = { /* U+0400..U+045F → ASCII */
+    0,   '~', 0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   'F', '<', 'D', 'U', 'L', 'T', ':', 'P', 'B', 'Q', 'R', 'K',
+    'V', 'Y', 'J', 'G', 'H', 'C', 'N', 'E', 'A', '{', 'W', 'X', 'I', 'O',
+    '}', 'S', 'M', '"', '>', 'Z', 'f', ',', 'd', 'u', 'l', 't', ';', 'p',
+    'b', 'q', 'r', 'k', 'v', 'y', 'j', 'g', 'h', 'c', 'n', 'e', 'a', '[',
+    'w', 'x', 'i', 'o', ']', 's', 'm', '\'', '.', 'z', 0,  '`'};
+
+static const unsigned short lat2cyr[0x80] = {
+    ['"'] = 0x42d,  ['\''] = 0x44d, [','] = 0x431, ['.'] = 0x44e,
+    [':'] = 0x416,  [';'] = 0x436,  ['<'] = 0x411, ['>'] = 0x42e,
+    ['A'] = 0x424,  ['B'] = 0x418,  ['C'] = 0x421, ['D'] = 0x412,
+    ['E'] = 0x423,  ['F'] = 0x410,  ['G'] = 0x41f, ['H'] = 0x420,
+    ['I'] = 0x428,  ['J'] = 0x41e,  ['K'] = 0x41b, ['L'] = 0x414,
+    ['M'] = 0x42c,  ['N'] = 0x422,  ['O'] = 0x429, ['P'] = 0x417,
+    ['Q'] = 0x419,  ['R'] = 0x41a,  ['S'] = 0x42b, ['T'] = 0x415,
+    ['U'] = 0x413,  ['V'] = 0x41c,  ['W'] = 0x426, ['X'] = 0x427,
+    ['Y'] = 0x41d,  ['Z'] = 0x42f,  ['['] = 0x445, [']'] = 0x44a,
+    ['`'] = 0x451,  ['a'] = 0x444,  ['b'] = 0x438, ['c'] = 0x441,
+    ['d'] = 0x432,  ['e'] = 0x443,  ['f'] = 0x430, ['g'] = 0x43f,
+    ['h'] = 0x440,  ['i'] = 0x448,  ['j'] = 0x43e, ['k'] = 0x43b,
+    ['l'] = 0x434,  ['m'] = 0x44c,  ['n'] = 0x442, ['o'] = 0x449,
+    ['p'] = 0x437,  ['q'] = 0x439,  ['r'] = 0x43a, ['s'] = 0x44b,
+    ['t'] = 0x435,  ['u'] = 0x433,  ['v'] = 0x43c, ['w'] = 0x446,
+    ['x'] = 0x447,  ['y'] = 0x43d,  ['z'] = 0x44f, ['{'] = 0x425,
+    ['}'] = 0x42a,  ['~'] = 0x401};
+
+/* клавиша в любой раскладке → символ QWERTY на той же позиции */
+int tv_qwerty(int cp) {
+  static const char arrows[] = "kjlh";
+  if (cp >= TV_KEY_UP && cp <= TV_KEY_LEFT)
+    return arrows[cp - TV_KEY_UP];
+  if (cp >= 0x400 && cp < 0x460 && cyr2lat[cp - 0x400])
+    return cyr2lat[cp - 0x400];
+  return cp;
+}
+
+int tv_fold_case(int cp) {
+  if (cp >= 'A' && cp <= 'Z')
+    return cp + 32;
+  if (cp >= 0x410 && cp <= 0x42f)
+    return cp + 0x20;
+  if (cp == 0x401)
+    return 0x451;
+  return cp;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   SEARCH
+   Индекс строки: "<текст>\x01<тот же текст в другой раскладке>", всё в
+   нижнем регистре. Запрос "пше" находит "git" одним strstr.
+   ══════════════════════════════════════════════════════════════════════ */
+
+/* позиция следующего ESC или n; по 16 байт за раз — в обычном тексте
+   ESC нет, так что проход почти такой же быстрый, как memchr */
+static size_t esc_scan(const char *s, size_t i, size_t n) {
+#ifdef __SSE2__
+  const __m128i esc = _mm_set1_epi8(27);
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    int m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, esc));
+    if (m)
+      return i + (size_t)__builtin_ctz((unsigned)m);
+  }
+#endif
+  while (i < n && s[i] != 27)
+    i++;
+  return i;
+}
+
+/* вырезать CSI-последовательности (SGR и прочие ESC[...X); out может
+   совпадать с s, длина результата <= n */
+size_t tv_ansi_strip(const char *s, size_t n, char *out) {
+  size_t i = 0, o = 0;
+  while (i < n) {
+    size_t j = esc_scan(s, i, n);
+    memmove(out + o, s + i, j - i);
+    o += j - i;
+    i = j + 1;
+    if (i < n && s[i] == '[') {
+      i++;
+      while (i < n && (s[i] < 0x40 || s[i] > 0x7e))
+        i++;
+      i++;
+    }
+  }
+  return o;
+}
+
+size_t tv_fold(const char *s, char *out, size_t cap, int transpose) {
+  size_t n = 0;
+  while (*s && n + 5 < cap) {
+    int cp = tv_fold_case(tv_utf8_next(&s));
+    if (transpose) {
+      if (cp < 0x80 && lat2cyr[cp])
+        cp = tv_fold_case(lat2cyr[cp]);
+      else if (cp >= 0x400 && cp < 0x460 && cyr2lat[cp - 0x400])
+        cp = tv_fold_case(cyr2lat[cp - 0x400]);
+    }
+    n += (size_t)tv_utf8_put(out + n, cp);
+  }
+  out[n] = '\0';
+  return n;
+}
+
+void tv_srch_build(const char *plain, char *buf, size_t cap) {
+  size_t n = tv_fold(plain, buf, cap / 2, 0);
+  buf[n++] = '\x01';
+  tv_fold(plain, buf + n, cap - n, 1);
+}
+
+char *tv_search_index(const char *text) {
+  char plain[512], buf[2048];
+  size_t n = strlen(text);
+  if (n >= sizeof(plain))
+    n = sizeof(plain) - 1;
+  plain[tv_ansi_strip(text, n, plain)] = '\0';
+  tv_srch_build(plain, buf, sizeof(buf));
+  return strdup(buf);
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   FLAT
+   Секция → строки экрана: T: — рамка из трёх строк, G: — пустая +
+   заголовок, R:/C:/N: — по строке.
+   ══════════════════════════════════════════════════════════════════════ */
+
+void tv_flat_push(TvFlat *f, TvLine l) {
+  if (f->n >= f->cap) {
+    int nc = f->cap ? f->cap * 2 : 128;
+    TvLine *tmp = realloc(f->v, (size_t)nc * sizeof(TvLine));
+    if (!tmp)
+      return;
+    f->v = tmp;
+    f->cap = nc;
+  }
+  f->v[f->n++] = l;
+  f->gen++;
+}
+
+void tv_flat_free(TvFlat *f) {
+  for (int i = 0; i < f->n; i++) {
+    if (!f->v[i].mapped) {
+      free(f->v[i].text);
+      free(f->v[i].srch);
+    }
+    f->v[i].text = NULL;
+    f->v[i].srch = NULL;
+  }
+  f->n = 0;
+  f->gen++;
+}
+
+void tv_flat_release(TvFlat *f) {
+  tv_flat_free(f);
+  free(f->v);
+  f->v = NULL;
+  f->cap = 0;
+}
+
+static void flat_add(TvFlat *f, const char *s, int src) {
+  tv_flat_push(f, (TvLine){strdup(s), NULL, src, 0});
+}
+
+void tv_row_render(const Tutor *t, const char *line, char *buf, size_t cap) {
+  const char *content = line + 2;
+
+  switch (line[0]) {
+  case 'R': {
+    char key[80], desc[256];
+    const char *pipe = strchr(content, '|');
+    if (pipe) {
+      int klen = (int)(pipe - content);
+      if (klen >= (int)sizeof(key))
+        klen = (int)sizeof(key) - 1;
+      memcpy(key, content, (size_t)klen);
+      key[klen] = '\0';
+      snprintf(desc, sizeof(desc), "%s", pipe + 1);
+    } else {
+      snprintf(key, sizeof(key), "%s", content);
+      desc[0] = '\0';
+    }
+    snprintf(buf, cap, "  " C_KEY BOLD "%-*s" RESET C_DESC "  %s" RESET,
+             t->key_w, key, desc);
+    break;
+  }
+
+  case 'C':
+    snprintf(buf, cap, C_CODE "  $ %s" RESET, content);
+    break;
+
+  case 'N':
+    snprintf(buf, cap, C_HINT DIM "  > %s" RESET, content);
+    break;
+
+  default:
+    snprintf(buf, cap, "  %s", line);
+  }
+}
+
+void tv_flat_build(TvFlat *f, const Tutor *t, const char **sec) {
+  tv_flat_free(f);
+  tv_flat_append(f, t, sec, 0);
+}
+
+void tv_flat_append(TvFlat *f, const Tutor *t, const char **sec, int from) {
+  char buf[512];
+  for (int i = from; sec[i]; i++) {
+    const char *line = sec[i];
+    const char *content = line + 2;
+
+    switch (line[0]) {
+    case 'T':
+      flat_add(f,
+               C_SEP
+               "  ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" RESET,
+               i);
+      snprintf(buf, sizeof(buf), "%s" BOLD "  %s" RESET, t->title, content);
+      flat_add(f, buf, i);
+      flat_add(f,
+               C_SEP
+               "  ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━" RESET,
+               i);
+      break;
+
+    case 'G':
+      flat_add(f, "", i);
+      snprintf(buf, sizeof(buf), C_HEAD BOLD "  ## %s" RESET, content);
+      flat_add(f, buf, i);
+      break;
+
+    case 'B':
+      flat_add(f, "", i);
+      break;
+
+    case 'P': /* как есть: вывод man/--help в DETAIL PAGES tutor'а */
+      snprintf(buf, sizeof(buf), C_DESC "  %s" RESET, content);
+      flat_add(f, buf, i);
+      break;
+
+    default:
+      tv_row_render(t, line, buf, sizeof(buf));
+      flat_add(f, buf, i);
+    }
+  }
+}
+
+const char *tv_flat_srch(TvFlat *f, int i) {
+  if (!f->v[i].srch)
+    f->v[i].srch = tv_search_index(f->v[i].text);
+  return f->v[i].srch ? f->v[i].srch : "";
+}
+
+int tv_flat_find(TvFlat *f, const char *query, int from, int dir) {
+  char q[512];
+  tv_fold(query, q, sizeof(q), 0);
+  if (!q[0] || f->n == 0)
+    return -1;
+  for (int k = 0; k < f->n; k++) {
+    int i = ((from + dir * k) % f->n + f->n) % f->n;
+    if (strstr(tv_flat_srch(f, i), q))
+      return i;
+  }
+  return -1;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   VIEWER
+   Кадр копится в v->fbuf и уходит в sink одним вызовом.
+   ══════════════════════════════════════════════════════════════════════ */
+
+static void fb_appendn(TutorView *v, const char *s, size_t n) {
+  if (v->flen + n + 1 > v->fcap) {
+    size_t nc = v->fcap ? v->fcap * 2 : 8192;
+    while (nc < v->flen + n + 1)
+      nc *= 2;
+    char *tmp = realloc(v->fbuf, nc);
+    if (!tmp)
+      return;
+    v->fbuf = tmp;
+    v->fcap = nc;
+  }
+  memcpy(v->fbuf + v->flen, s, n);
+  v->flen += n;
+  v->fbuf[v->flen] = '\0';
+}
+
+static void fb_append(TutorView *v, const char *s) {
+  fb_appendn(v, s, strlen(s));
+}
+
+static void fb_appendf(TutorView *v, const char *fmt, ...) {
+  char tmp[1024];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(tmp, sizeof(tmp), fmt, ap);
+  va_end(ap);
+  fb_append(v, tmp);
+}
+
+static void fb_emit(TutorView *v) {
+  if (v->flen && v->sink)
+    v->sink(v->user, v->fbuf, v->flen);
+  v->flen = 0;
+}
+
+void tv_init(TutorView *v, const Tutor *t, TvSink sink, void *user) {
+  memset(v, 0, sizeof(*v));
+  v->tutor = t;
+  v->sink = sink;
+  v->user = user;
+  v->rows = 24;
+}
+
+void tv_free(TutorView *v) {
+  tv_flat_release(&v->flat);
+  free(v->fbuf);
+  v->fbuf = NULL;
+  v->flen = v->fcap = 0;
+  free(v->lay_at);
+  free(v->lay_grid);
+  v->lay_at = NULL;
+  v->lay_grid = NULL;
+  v->lay_cap = v->lay_n = 0;
+}
+
+void tv_open(TutorView *v, const char **sec) {
+  tv_flat_build(&v->flat, v->tutor, sec);
+  v->cursor = v->offset = 0;
+  v->last_g = v->searching = v->not_found = 0;
+}
+
+/* ── колонки ────────────────────────────────────────────────────────── */
+/* Секции высокие и узкие: на широком экране G:-блоки раскладываются в
+   колонки, шапка (T:) остаётся сверху. Колонок берём столько, чтобы
+   секция влезла на экран, но не больше, чем помещается по ширине; блоки
+   идут по порядку, жадно: блок уходит в следующую колонку, если с ним
+   текущая перерастёт среднюю высоту сильнее, чем недотянет без него.
+   j/k по-прежнему идут по flat — с низа колонки на верх следующей. */
+
+static int text_width(const char *s) {
+  int w = 0;
+  while (*s) {
+    unsigned char c = (unsigned char)*s;
+    if (c == 27 && s[1] == '[') {
+      for (s += 2; *s && ((unsigned char)*s < 0x40 || (unsigned char)*s > 0x7e);
+           s++)
+        ;
+      if (*s)
+        s++;
+      continue;
+    }
+    w += c >= 0x20 && (c & 0xc0) != 0x80;
+    s++;
+  }
+  return w;
+}
+
+/* G: — пустая строка + заголовок с тем же src (FLAT) */
+static int group_start(const TvFlat *f, int i) {
+  return !f->v[i].text[0] && i + 1 < f->n && f->v[i + 1].src == f->v[i].src;
+}
+
+/* блоки gs[0..ng) в ncol колонок; → высота самой высокой. at != NULL —
+   заодно записать строку и колонку каждой строки flat */
+static int layout_pack(const int *gs, int ng, int n, int ncol, TvCell *at) {
+  int head = gs[0], target = (n - head + ncol - 1) / ncol;
+  int col = 0, h = 0, maxh = 0;
+  for (int k = 0; k < ng; k++) {
+    int len = (k + 1 < ng ? gs[k + 1] : n) - gs[k];
+    if (h > 0 && col < ncol - 1 && h + len - target > target - h) {
+      col++;
+      h = 0;
+    }
+    for (int i = gs[k]; at && i < gs[k] + len; i++) {
+      at[i].row = head + h + (i - gs[k]);
+      at[i].col = col;
+    }
+    h += len;
+    maxh = h > maxh ? h : maxh;
+  }
+  return maxh;
+}
+
+static void layout(TutorView *v) {
+  TvFlat *f = &v->flat;
+  if (v->lay_rows == v->rows && v->lay_cols == v->cols &&
+      v->lay_n == f->n && v->lay_gen == f->gen && v->lay_ncol > 0)
+    return;
+  v->lay_rows = v->rows;
+  v->lay_cols = v->cols;
+  v->lay_n = f->n;
+  v->lay_gen = f->gen;
+  v->lay_ncol = 1;
+  int visible = v->rows - 3;
+  if (v->cols <= 0 || f->n <= visible)
+    return; /* и так влезает */
+
+  if (f->n > v->lay_cap) {
+    TvCell *at = realloc(v->lay_at, sizeof(*at) * (size_t)f->n);
+    if (!at)
+      return;
+    v->lay_at = at;
+    v->lay_cap = f->n;
+  }
+  int colw = 0, ng = 0;
+  for (int i = 0; i < f->n; i++) {
+    v->lay_at[i].width = text_width(f->v[i].text);
+    colw = v->lay_at[i].width > colw ? v->lay_at[i].width : colw;
+    ng += group_start(f, i);
+  }
+  colw += 2;
+  int maxcol = (v->cols - 1) / colw; /* последняя колонка экрана — пустая */
+  if (maxcol < 2 || ng < 2)
+    return;
+
+  int *gs = malloc(sizeof(int) * (size_t)ng);
+  if (!gs)
+    return;
+  ng = 0;
+  for (int i = 0; i < f->n; i++)
+    if (group_start(f, i))
+      gs[ng++] = i;
+  int ncol = 2;
+  while (ncol < maxcol &&
+         gs[0] + layout_pack(gs, ng, f->n, ncol, NULL) > visible)
+    ncol++;
+  int h = gs[0] + layout_pack(gs, ng, f->n, ncol, v->lay_at);
+  for (int i = 0; i < gs[0]; i++) { /* шапка — сверху, в первой колонке */
+    v->lay_at[i].row = i;
+    v->lay_at[i].col = 0;
+  }
+  free(gs);
+
+  int *grid = realloc(v->lay_grid, sizeof(int) * (size_t)(h * ncol));
+  if (!grid)
+    return;
+  v->lay_grid = grid;
+  for (int i = 0; i < h * ncol; i++)
+    grid[i] = -1;
+  for (int i = 0; i < f->n; i++)
+    grid[v->lay_at[i].row * ncol + v->lay_at[i].col] = i;
+  v->lay_ncol = ncol;
+  v->lay_colw = colw;
+  v->lay_h = h;
+}
+
+/* H/L: курсор в соседнюю колонку, на ту же строку экрана или ближайшую
+   выше (ниже — если выше в той колонке ничего) */
+static void layout_step(TutorView *v, int dir) {
+  layout(v);
+  if (v->lay_ncol < 2 || v->flat.n == 0)
+    return;
+  const TvCell *c = &v->lay_at[v->cursor];
+  int col = c->col + dir;
+  if (col < 0 || col >= v->lay_ncol)
+    return;
+  for (int y = c->row; y >= 0; y--)
+    if (v->lay_grid[y * v->lay_ncol + col] >= 0) {
+      v->cursor = v->lay_grid[y * v->lay_ncol + col];
+      return;
+    }
+  for (int y = c->row + 1; y < v->lay_h; y++)
+    if (v->lay_grid[y * v->lay_ncol + col] >= 0) {
+      v->cursor = v->lay_grid[y * v->lay_ncol + col];
+      return;
+    }
+}
+
+/* tv_draw при lay_ncol > 1 */
+static void draw_columns(TutorView *v) {
+  int visible = v->rows - 3, ncol = v->lay_ncol;
+  int row = v->lay_at[v->cursor].row;
+  if (v->offset > v->lay_h - visible)
+    v->offset = v->lay_h - visible;
+  if (row < v->offset)
+    v->offset = row;
+  if (row >= v->offset + visible)
+    v->offset = row - visible + 1;
+  if (v->offset < 0)
+    v->offset = 0;
+
+  v->flen = 0;
+  fb_append(v, CLR);
+  for (int y = v->offset; y < v->offset + visible && y < v->lay_h; y++) {
+    int pad = 0;
+    for (int c = 0; c < ncol; c++) {
+      int i = v->lay_grid[y * ncol + c];
+      if (i < 0) {
+        pad += v->lay_colw;
+        continue;
+      }
+      fb_appendf(v, "%*s", pad, "");
+      if (i == v->cursor)
+        fb_appendf(v, C_CUR "%s" RESET, v->flat.v[i].text);
+      else
+        fb_append(v, v->flat.v[i].text);
+      pad = v->lay_colw - v->lay_at[i].width;
+    }
+    fb_append(v, "\n");
+  }
+}
+
+void tv_draw(TutorView *v) {
+  int total = v->flat.n;
+  int visible = v->rows - 3;
+  if (v->cursor >= total)
+    v->cursor = total - 1;
+  if (v->cursor < 0)
+    v->cursor = 0;
+  layout(v);
+  if (v->lay_ncol > 1 && total > 0)
+    draw_columns(v);
+  else {
+    if (v->cursor < v->offset)
+      v->offset = v->cursor;
+    if (v->cursor >= v->offset + visible)
+      v->offset = v->cursor - visible + 1;
+    if (v->offset < 0)
+      v->offset = 0;
+
+    v->flen = 0;
+    fb_append(v, CLR);
+    for (int i = v->offset; i < v->offset + visible && i < total; i++) {
+      if (i == v->cursor)
+        fb_appendf(v, C_CUR "%s" RESET "\n", v->flat.v[i].text);
+      else
+        fb_appendf(v, "%s\n", v->flat.v[i].text);
+    }
+  }
+
+  fb_append(
+      v, C_SEP
+      "  ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n" RESET);
+  if (v->searching)
+    fb_appendf(v, C_KEY "  /%s" RESET "█%s\n", v->query,
+               v->not_found ? C_SEP "  [не найдено]" RESET : "");
+  else
+    fb_appendf(v,
+               C_HINT "  j/k↕  %sd/u ½  gg/G  %% край↔край  / поиск  n/N  "
+                      "q выход" C_SEP "  [%d/%d]%s\n" RESET,
+               v->lay_ncol > 1 ? "H/L ⇆  " : "", v->cursor + 1, total,
+               v->not_found ? "  [не найдено]" : "");
+  fb_emit(v);
+}
+
+/* ввод запроса в строке подсказки */
+static int search_key(TutorView *v, int cp) {
+  if (cp == '\r' || cp == '\n') {
+    v->searching = 0;
+  } else if (cp == 27 || cp == -1) {
+    v->searching = 0;
+    v->not_found = 0;
+    v->cursor = v->search_from;
+  } else if (cp == 127 || cp == 8) {
+    /* стереть последний символ целиком, а не байт */
+    while (v->qlen > 0 && ((unsigned char)v->query[--v->qlen] & 0xc0) == 0x80)
+      ;
+    v->query[v->qlen] = '\0';
+  } else if (cp >= 0x20 && cp < TV_KEY_UP && v->qlen + 4 < sizeof(v->query)) {
+    v->qlen += (size_t)tv_utf8_put(v->query + v->qlen, cp);
+    v->query[v->qlen] = '\0';
+  }
+  if (v->searching) {
+    int hit = tv_flat_find(&v->flat, v->query, v->search_from, 1);
+    v->not_found = v->qlen > 0 && hit < 0;
+    v->cursor = hit >= 0 ? hit : v->search_from;
+  }
+  return TV_OK;
+}
+
+int tv_key(TutorView *v, int key) {
+  if (v->searching)
+    return search_key(v, key);
+  key = tv_qwerty(key); /* навигации раскладка не важна */
+  int total = v->flat.n;
+  int visible = v->rows - 3;
+  v->not_found = 0;
+
+  if (key == 'j') {
+    if (v->cursor < total - 1)
+      v->cursor++;
+    v->last_g = 0;
+  } else if (key == 'k') {
+    if (v->cursor > 0)
+      v->cursor--;
+    v->last_g = 0;
+  } else if (key == 'd') {
+    v->cursor += visible / 2;
+    v->last_g = 0;
+  } else if (key == 'u') {
+    v->cursor -= visible / 2;
+    v->last_g = 0;
+  } else if (key == 'g') {
+    if (v->last_g) {
+      v->cursor = 0;
+      v->offset = 0;
+      v->last_g = 0;
+    } else
+      v->last_g = 1;
+  } else if (key == 'G') {
+    v->cursor = total - 1;
+    v->last_g = 0;
+  } else if (key == '%') {
+    v->cursor = (v->cursor < total / 2) ? total - 1 : 0;
+    v->last_g = 0;
+  } else if (key == 'H' || key == 'L') {
+    layout_step(v, key == 'L' ? 1 : -1);
+    v->last_g = 0;
+  } else if (key == '\r' || key == '\n') {
+    v->last_g = 0;
+    return TV_ENTER;
+  } else if (key == '/') {
+    v->searching = 1;
+    v->search_from = v->cursor;
+    v->qlen = 0;
+    v->query[0] = '\0';
+    v->last_g = 0;
+  } else if (key == 'n' || key == 'N') {
+    int hit = tv_flat_find(&v->flat, v->query,
+                           v->cursor + (key == 'n' ? 1 : -1),
+                           key == 'n' ? 1 : -1);
+    if (hit >= 0)
+      v->cursor = hit;
+    else
+      v->not_found = v->qlen > 0;
+    v->last_g = 0;
+  } else if (key == 'x' || key == 'h' || key == 'q' || key == 27 ||
+             key == -1) {
+    return TV_CLOSE;
+  } else {
+    v->last_g = 0;
+  }
+  return TV_OK;
+}
+
+void tv_menu(TutorView *v, const char *const *items, int n, int recent,
+             int cur, const char *hint) {
+  v->flen = 0;
+  fb_append(v, CLR);
+  fb_append(v, v->tutor->banner);
+  fb_append(
+      v, C_SEP
+      "  ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n" RESET);
+
+  for (int i = 0; i < n; i++) {
+    if (i == cur)
+      fb_appendf(v, C_CUR BOLD "  ▶  %s" RESET "\n", items[i]);
+    else if (recent && i == 0)
+      fb_appendf(v, C_KEY "  [0]" C_HEAD "  %s\n" RESET, items[i]);
+    else
+      fb_appendf(v, C_KEY "  [%d]" C_DESC "  %s\n" RESET, i + !recent,
+                 items[i]);
+  }
+
+  fb_append(
+      v, C_SEP
+      "  ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n" RESET);
+  fb_append(v, hint ? hint
+                    : C_HINT "  j/k выбор   l/Enter открыть   % край↔край   "
+                             "q выход\n" RESET);
+  fb_emit(v);
+}
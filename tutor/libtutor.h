@@ -0,0 +1,104 @@
+/* libtutor.h — просмотрщик секций для встраивания (greeter, попапы)
+   Всё состояние — в TutorView, глобального нет: в одном процессе
+   может жить сколько угодно просмотрщиков. Кадр уходит целиком в
+   TvSink, ввод приходит через tv_key — терминал, termios и цикл
+   событий остаются у вызывающего. Сам tutor собран на том же. */
+#ifndef LIBTUTOR_H
+#define LIBTUTOR_H
+
+#include <stddef.h>
+
+#include "tutor.h"
+
+/* ── клавиши ────────────────────────────────────────────────────────── */
+/* стрелки — за пределами Unicode, чтобы не путать с вводом в поиске */
+enum { TV_KEY_UP = 0x110000, TV_KEY_DOWN, TV_KEY_RIGHT, TV_KEY_LEFT };
+
+/* ── UTF-8, раскладка, поиск ────────────────────────────────────────── */
+int tv_utf8_next(const char **s); /* битые байты → U+FFFD */
+int tv_utf8_put(char *out, int cp);
+int tv_qwerty(int cp);    /* любая раскладка/стрелка → клавиша QWERTY */
+int tv_fold_case(int cp); /* нижний регистр, латиница и кириллица */
+/* вырезать CSI-последовательности; out может совпадать с s */
+size_t tv_ansi_strip(const char *s, size_t n, char *out);
+/* нижний регистр; transpose=1 — заодно перевести в другую раскладку */
+size_t tv_fold(const char *s, char *out, size_t cap, int transpose);
+/* "<текст>\x01<он же в другой раскладке>": запрос "пше" находит "git" */
+void tv_srch_build(const char *plain, char *buf, size_t cap);
+char *tv_search_index(const char *text); /* malloc, по строке с ANSI */
+
+/* ── строки экрана ──────────────────────────────────────────────────── */
+typedef struct {
+  char *text;  /* heap-allocated */
+  char *srch;  /* поисковый индекс, строится лениво */
+  int src;     /* индекс исходной строки секции */
+  int mapped;  /* text и srch чужие (mmap), не освобождать */
+} TvLine;
+
+typedef struct {
+  TvLine *v;
+  int n, cap;
+  unsigned gen; /* растёт при каждой правке: пора пересчитать колонки */
+} TvFlat;
+
+void tv_flat_push(TvFlat *f, TvLine l);
+void tv_flat_free(TvFlat *f);    /* строки; массив остаётся для повтора */
+void tv_flat_release(TvFlat *f); /* и массив */
+/* R/C/N-строка → одна строка экрана */
+void tv_row_render(const Tutor *t, const char *line, char *buf, size_t cap);
+/* секция (T:/G:/R:/C:/N:/B:/P:-строки) → строки экрана шпаргалки t */
+void tv_flat_build(TvFlat *f, const Tutor *t, const char **sec);
+/* дописать строки sec[from..] — для секции, которая ещё растёт */
+void tv_flat_append(TvFlat *f, const Tutor *t, const char **sec, int from);
+const char *tv_flat_srch(TvFlat *f, int i);
+/* первая строка с совпадением, начиная с from в направлении dir */
+int tv_flat_find(TvFlat *f, const char *query, int from, int dir);
+
+/* ── просмотрщик ────────────────────────────────────────────────────── */
+typedef void (*TvSink)(void *user, const char *buf, size_t n);
+
+/* место строки flat в раскладке по колонкам */
+typedef struct {
+  int row, col; /* строка экрана (от начала раскладки) и колонка */
+  int width;    /* ширина текста в ячейках */
+} TvCell;
+
+typedef struct {
+  const Tutor *tutor;
+  TvSink sink;
+  void *user;
+  int rows; /* высота экрана; ставит вызывающий перед tv_draw */
+  int cols; /* ширина; 0 — в одну колонку, как раньше */
+  TvFlat flat;
+  int cursor, offset; /* offset — первая видимая строка раскладки */
+  int last_g;
+  char query[256];
+  size_t qlen;
+  int searching; /* 1 — вводим запрос в строке подсказки */
+  int search_from;
+  int not_found;
+  char *fbuf; /* кадр */
+  size_t flen, fcap;
+  /* G:-блоки по колонкам: считается раз на размер экрана и flat */
+  int lay_rows, lay_cols, lay_n;
+  unsigned lay_gen;
+  int lay_ncol, lay_colw, lay_h; /* 1 — обычный вид в одну колонку */
+  TvCell *lay_at;                /* по строке flat */
+  int *lay_grid;                 /* lay_h × lay_ncol → строка flat, -1 */
+  int lay_cap;
+} TutorView;
+
+/* tv_key: что делать вызывающему */
+enum { TV_OK, TV_CLOSE, TV_ENTER };
+
+void tv_init(TutorView *v, const Tutor *t, TvSink sink, void *user);
+void tv_free(TutorView *v);
+void tv_open(TutorView *v, const char **sec); /* курсор — наверх */
+void tv_draw(TutorView *v);
+int tv_key(TutorView *v, int key); /* codepoint как есть или TV_KEY_* */
+/* меню: items[0] при recent != 0 — особый пункт [0], остальные с [1];
+   hint — строка подсказки (NULL — стандартная) */
+void tv_menu(TutorView *v, const char *const *items, int n, int recent,
+             int cur, const char *hint);
+
+#endif /* LIBTUTOR_H */
@@ -0,0 +1,5277 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "libtutor.h"
+#include "tutor.h"
+
+/* ── tutor ──────────────────────────────────────────────────────────── */
+static const Tutor *const tutors[] = {&tutor_git, &tutor_zsh, &tutor_nvim};
+#define TUTORS_N (int)(sizeof(tutors) / sizeof(tutors[0]))
+static int tutor_idx = 0;
+static const Tutor *tutor = &tutor_git; /* tutors[tutor_idx] */
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ── время старта ───────────────────────────────────────────────────── */
+/* TUTOR_STARTUP_LOG=файл: от execve до первого байта в терминал и до
+   первого целого кадра, мкс. Точного момента execve ядро не отдаёт; до
+   конструкторов процесс только грузится и не спит, так что execve ≈
+   CLOCK_MONOTONIC в самом раннем конструкторе минус потраченное
+   процессорное время. Ребёнок DAEMON получает это время от клиента. */
+static int64_t boot_ns = 0;      /* 0 — уже записали или не меряем */
+static int64_t boot_byte_ns = 0; /* первый write в stdout */
+
+__attribute__((constructor(101))) static void boot_mark(void) {
+  struct timespec cpu;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+  boot_ns = now_ns() - (cpu.tv_sec * 1000000000LL + cpu.tv_nsec);
+}
+
+/* первый целый кадр: одна строка "<шпаргалка> <байт> <кадр>" */
+static void boot_log(void) {
+  int64_t now = now_ns();
+  const char *path = getenv("TUTOR_STARTUP_LOG");
+  int fd = path && *path ? open(path, O_WRONLY | O_APPEND | O_CREAT |
+                                          O_CLOEXEC, 0644)
+                         : -1;
+  if (fd >= 0) {
+    dprintf(fd, "%s %lld %lld\n", tutor->name,
+            (long long)(boot_byte_ns - boot_ns) / 1000,
+            (long long)(now - boot_ns) / 1000);
+    close(fd);
+  }
+  boot_ns = 0;
+}
+
+/* ── frame buffer ───────────────────────────────────────────────────── */
+static char *fbuf = NULL;
+static size_t fbuf_cap = 0;
+static size_t fbuf_len = 0;
+
+/* suppress warn_unused_result for terminal write calls */
+static void xwrite(const void *buf, size_t n) {
+  ssize_t r = write(STDOUT_FILENO, buf, n);
+  (void)r;
+  if (!boot_byte_ns)
+    boot_byte_ns = now_ns();
+}
+
+static void fb_reset(void) { fbuf_len = 0; }
+
+static void fb_appendn(const char *s, size_t n) {
+  if (fbuf_len + n + 1 > fbuf_cap) {
+    size_t nc = fbuf_cap ? fbuf_cap * 2 : 8192;
+    while (nc < fbuf_len + n + 1)
+      nc *= 2;
+    char *tmp = realloc(fbuf, nc);
+    if (!tmp)
+      return;
+    fbuf = tmp;
+    fbuf_cap = nc;
+  }
+  memcpy(fbuf + fbuf_len, s, n);
+  fbuf_len += n;
+  fbuf[fbuf_len] = '\0';
+}
+
+static void fb_append(const char *s) { fb_appendn(s, strlen(s)); }
+
+static void fb_appendf(const char *fmt, ...) {
+  char tmp[1024];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(tmp, sizeof(tmp), fmt, ap);
+  va_end(ap);
+  fb_append(tmp);
+}
+
+static void fb_flush(void) {
+  if (fbuf_len)
+    xwrite(fbuf, fbuf_len);
+  fbuf_len = 0;
+}
+
+/* ── raw terminal ───────────────────────────────────────────────────── */
+static struct termios orig_term;
+static int term_is_raw = 0;
+
+static void term_restore(void) {
+  if (!term_is_raw)
+    return;
+  struct termios t;
+  if (tcgetattr(STDIN_FILENO, &t) != 0 || memcmp(&t, &orig_term, sizeof(t)))
+    tcsetattr(STDIN_FILENO, TCSANOW, &orig_term);
+  /* показать курсор + вернуть основной буфер */
+  xwrite(CUR_SHOW ALT_OFF, sizeof(CUR_SHOW ALT_OFF) - 1);
+  term_is_raw = 0;
+}
+
+static void sig_handler(int sig) {
+  (void)sig;
+  term_restore();
+  _exit(0);
+}
+
+static void term_raw(void) {
+  struct termios t;
+  tcgetattr(STDIN_FILENO, &orig_term);
+  t = orig_term;
+  t.c_lflag &= ~(ICANON | ECHO);
+  t.c_cc[VMIN] = 1;
+  t.c_cc[VTIME] = 0;
+  /* из виджета ZLE терминал уже в таком режиме — не дёргаем его зря */
+  if (memcmp(&t, &orig_term, sizeof(t)))
+    tcsetattr(STDIN_FILENO, TCSANOW, &t);
+  xwrite(ALT_ON, sizeof(ALT_ON) - 1);
+  term_is_raw = 1;
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sig_handler;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGHUP, &sa, NULL);
+}
+
+static int term_rows(void) {
+  struct winsize w;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_row > 4)
+    return (int)w.ws_row;
+  return 24;
+}
+
+static int term_cols(void) {
+  struct winsize w;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_col > 8)
+    return (int)w.ws_col;
+  return 80;
+}
+
+/* ── terminal caps ──────────────────────────────────────────────────── */
+/* Как быстрее рисовать, зависит от терминала. Вместе с ALT_ON уходят
+   запросы (TERMINAL PROBE), ответы разбирает key_decode, а кадры
+   подстраиваются под них по ходу дела: первый кадр никого не ждёт.
+   DA1 отвечают все — он последний, его ответ значит «опрос окончен». */
+#define TERM_QUERY                                                      \
+  "\033[?2026$p" /* DECRQM: synchronized output */                      \
+  "\033[>0q"     /* XTVERSION: имя и версия */                          \
+  "\033[c"       /* DA1 */
+
+#define TERM_BSU "\033[?2026h" /* begin/end synchronized update */
+#define TERM_ESU "\033[?2026l"
+
+enum {
+  TERM_SYNC = 1,     /* кадр между BSU/ESU: терминал покажет его целиком */
+  TERM_REP = 2,      /* повтор символа — CSI n b */
+  TERM_KNOWN = 0x100 /* опрос окончен или взят из кэша */
+};
+
+static atomic_int term_caps = 0; /* пишет поток ввода, читает отрисовка */
+static char term_version[64];    /* ответ XTVERSION, до TERM_KNOWN */
+
+/* терминалы, про которые известно, что REP они понимают */
+static const char *const term_rep_ok[] = {"XTerm(", "kitty(", "foot(",
+                                          "WezTerm ", "tmux "};
+
+/* ответ на TERM_QUERY: params — CSI без ESC [ и финального байта */
+static void term_reply(const char *params, int final) {
+  int caps = atomic_load_explicit(&term_caps, memory_order_relaxed);
+  if (final == 'y' && strncmp(params, "?2026;", 6) == 0) {
+    int ps = atoi(params + 6); /* 1/2 — есть, 0/4 — нет */
+    if (ps == 1 || ps == 2)
+      caps |= TERM_SYNC;
+  } else if (final == 'c') {
+    for (size_t i = 0; i < sizeof(term_rep_ok) / sizeof(*term_rep_ok); i++)
+      if (strncmp(term_version, term_rep_ok[i], strlen(term_rep_ok[i])) == 0)
+        caps |= TERM_REP;
+    caps |= TERM_KNOWN;
+  }
+  atomic_store_explicit(&term_caps, caps, memory_order_release);
+}
+
+/* кадр s → out (места не меньше n): серии одинаковых символов — через
+   REP. Выигрыш есть с 3 байт на символ, т. е. на рамках вроде ━ */
+static size_t term_rep_pack(const char *s, size_t n, char *out) {
+  size_t o = 0, i = 0;
+  while (i < n) {
+    unsigned char c = (unsigned char)s[i];
+    if (c == 27) { /* escape-последовательности — как есть */
+      size_t j = i + 1;
+      if (j < n && s[j] == '[')
+        for (j++; j < n && ((unsigned char)s[j] < 0x40 ||
+                            (unsigned char)s[j] > 0x7e);
+             j++)
+          ;
+      j = j < n ? j + 1 : n;
+      memcpy(out + o, s + i, j - i);
+      o += j - i;
+      i = j;
+      continue;
+    }
+    size_t len = c < 0x20 || c == 0x7f ? 0
+                 : c < 0x80            ? 1
+                 : c >= 0xf0           ? 4
+                 : c >= 0xe0           ? 3
+                 : c >= 0xc0           ? 2
+                                       : 0;
+    if (len == 0 || i + len > n) { /* управляющий или битый байт */
+      out[o++] = s[i++];
+      continue;
+    }
+    size_t k = 1;
+    while (i + (k + 1) * len <= n && memcmp(s + i, s + i + k * len, len) == 0)
+      k++;
+    memcpy(out + o, s + i, len);
+    o += len;
+    char rep[16];
+    int rl = snprintf(rep, sizeof(rep), "\033[%zub", k - 1);
+    if ((k - 1) * len > (size_t)rl) {
+      memcpy(out + o, rep, (size_t)rl);
+      o += (size_t)rl;
+      i += k * len;
+    } else
+      i += len; /* короткая серия — символ за символом */
+  }
+  return o;
+}
+
+/* стрелки — из libtutor; KEY_RELOAD — не клавиша, а событие inotify
+   (HOT RELOAD), KEY_TICK — в tick_fd есть что читать */
+enum {
+  KEY_UP = TV_KEY_UP,
+  KEY_DOWN = TV_KEY_DOWN,
+  KEY_RIGHT = TV_KEY_RIGHT,
+  KEY_LEFT = TV_KEY_LEFT,
+  KEY_RELOAD,
+  KEY_TICK
+};
+
+/* ── keys ───────────────────────────────────────────────────────────── */
+/* Клавиатуру читает отдельный поток: декодирует клавиши и кладёт их с
+   временем нажатия в SPSC-кольцо без блокировок. Поток отрисовки берёт
+   события из кольца и не рисует кадр, пока за ним есть ещё клавиши:
+   медленный терминал больше не задерживает чтение ввода, а пачка j
+   превращается в один кадр. Будит его eventfd — только когда кольцо
+   было пусто. */
+static int watch_fd = -1; /* inotify из HOT RELOAD, -1 — не следим */
+static int tick_fd = -1;  /* фоновый вывод: eventfd LARGE DOCUMENT или
+                             труба DETAIL PAGES; читает получатель KEY_TICK */
+
+#define KEY_RING 256 /* степень двойки */
+
+typedef struct {
+  int key;
+  int64_t ns; /* CLOCK_MONOTONIC момента, когда клавиша прочитана */
+} KeyEvent;
+
+static KeyEvent key_ring[KEY_RING];
+static atomic_uint key_head = 0; /* пишет только поток ввода */
+static atomic_uint key_tail = 0; /* только поток отрисовки */
+static int key_fd = -1;          /* eventfd: в кольце появилось событие */
+static int key_started = 0;      /* 1 — поток есть, -1 — читаем сами */
+static int64_t key_ns = 0; /* самое раннее событие, ещё не показанное */
+static int key_log = -2;   /* TUTOR_LATENCY_LOG, -1 — не пишем */
+
+static int wait_byte(int usec) {
+  fd_set fds;
+  struct timeval tv = {0, usec};
+  FD_ZERO(&fds);
+  FD_SET(STDIN_FILENO, &fds);
+  return select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv) > 0;
+}
+
+/* одна клавиша с stdin (блокирует): codepoint или KEY_UP.. */
+static int key_decode(void) {
+  unsigned char c;
+  if (read(STDIN_FILENO, &c, 1) != 1)
+    return -1;
+
+  if (c == 27) {
+    /* escape: ждём продолжение max 50 мс */
+    unsigned char intro, b = 0;
+    if (!wait_byte(50000) || read(STDIN_FILENO, &intro, 1) != 1)
+      return 27; /* одиночный ESC */
+    if (intro == 'P') { /* DCS — ответ XTVERSION: ESC P >| текст ESC \ */
+      char dcs[sizeof(term_version) + 2];
+      size_t n = 0;
+      while (wait_byte(50000) && read(STDIN_FILENO, &b, 1) == 1 && b != 27)
+        if (n < sizeof(dcs) - 1)
+          dcs[n++] = (char)b;
+      dcs[n] = '\0';
+      if (b == 27 && wait_byte(50000)) {
+        ssize_t r = read(STDIN_FILENO, &b, 1); /* '\' */
+        (void)r;
+      }
+      if (strncmp(dcs, ">|", 2) == 0)
+        snprintf(term_version, sizeof(term_version), "%s", dcs + 2);
+      return 0;
+    }
+    if (intro != '[' && intro != 'O')
+      return 0; /* Alt+клавиша */
+    /* CSI целиком: параметры, промежуточные байты, финальный */
+    char params[32];
+    size_t n = 0;
+    do {
+      if (!wait_byte(50000) || read(STDIN_FILENO, &b, 1) != 1)
+        return 27;
+      if ((b < 0x40 || b > 0x7e) && n < sizeof(params) - 1)
+        params[n++] = (char)b;
+    } while (intro == '[' && (b < 0x40 || b > 0x7e));
+    params[n] = '\0';
+    if (params[0] == '?') { /* ответ терминала, не клавиша */
+      term_reply(params, b);
+      return 0;
+    }
+    if (n == 0) {
+      switch (b) {
+      case 'A':
+        return KEY_UP;
+      case 'B':
+        return KEY_DOWN;
+      case 'C':
+        return KEY_RIGHT;
+      case 'D':
+        return KEY_LEFT;
+      }
+    }
+    return 0; /* другая escape-последовательность */
+  }
+
+  if (c < 0x80)
+    return (int)c;
+
+  /* многобайтовый UTF-8: дочитываем хвост (приходит одним пакетом) */
+  char buf[4] = {(char)c};
+  int n = c >= 0xf0 ? 3 : c >= 0xe0 ? 2 : c >= 0xc0 ? 1 : 0;
+  for (int i = 1; i <= n; i++)
+    if (read(STDIN_FILENO, &buf[i], 1) != 1)
+      return 0;
+  const char *p = buf;
+  return tv_utf8_next(&p);
+}
+
+static void *key_reader(void *arg) {
+  (void)arg;
+  int key;
+  do {
+    key = key_decode();
+    if (key == 0) /* ответ терминала или незнакомая последовательность */
+      continue;
+    unsigned h = atomic_load_explicit(&key_head, memory_order_relaxed);
+    /* кольцо полно — отрисовка отстала на 256 клавиш; подождём её */
+    while (h - atomic_load_explicit(&key_tail, memory_order_acquire) ==
+           KEY_RING)
+      usleep(1000);
+    key_ring[h & (KEY_RING - 1)] = (KeyEvent){key, now_ns()};
+    atomic_store_explicit(&key_head, h + 1, memory_order_release);
+    uint64_t one = 1;
+    ssize_t w = write(key_fd, &one, sizeof(one));
+    (void)w;
+  } while (key != -1); /* EOF: дальше читать нечего */
+  return NULL;
+}
+
+static void key_start(void) {
+  pthread_t t;
+  key_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  key_started = key_fd >= 0 &&
+                        pthread_create(&t, NULL, key_reader, NULL) == 0
+                    ? 1
+                    : -1;
+  if (key_started > 0)
+    pthread_detach(t);
+}
+
+/* в кольце есть непрочитанные клавиши — кадр можно не рисовать */
+static int key_pending(void) {
+  return atomic_load_explicit(&key_head, memory_order_acquire) !=
+         atomic_load_explicit(&key_tail, memory_order_relaxed);
+}
+
+static int key_pop(void) {
+  unsigned t = atomic_load_explicit(&key_tail, memory_order_relaxed);
+  KeyEvent e = key_ring[t & (KEY_RING - 1)];
+  atomic_store_explicit(&key_tail, t + 1, memory_order_release);
+  if (!key_ns)
+    key_ns = e.ns;
+  return e.key;
+}
+
+/* возвращает codepoint нажатой клавиши или KEY_* */
+static int read_key_raw(void) {
+  if (!key_started)
+    key_start();
+  if (key_started < 0) { /* без потока — по-старому, в этом же */
+    key_ns = now_ns();
+    return key_decode();
+  }
+  while (1) {
+    if (key_pending())
+      return key_pop();
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(key_fd, &fds);
+    if (watch_fd >= 0)
+      FD_SET(watch_fd, &fds);
+    if (tick_fd >= 0)
+      FD_SET(tick_fd, &fds);
+    int nfds = key_fd;
+    nfds = watch_fd > nfds ? watch_fd : nfds;
+    nfds = tick_fd > nfds ? tick_fd : nfds;
+    if (select(nfds + 1, &fds, NULL, NULL, NULL) <= 0)
+      continue;
+    if (FD_ISSET(key_fd, &fds)) { /* клавиши важнее фоновых событий */
+      uint64_t v;
+      ssize_t r = read(key_fd, &v, sizeof(v));
+      (void)r;
+      continue;
+    }
+    return tick_fd >= 0 && FD_ISSET(tick_fd, &fds) ? KEY_TICK : KEY_RELOAD;
+  }
+}
+
+/* конец кадра: клавиши ещё в очереди — кадр устарел, не рисуем. Иначе
+   рисуем и, если задан TUTOR_LATENCY_LOG, пишем туда задержку от
+   нажатия до записи кадра в терминал, мкс. → 0, если кадр выброшен */
+static int fb_present(void) {
+  if (key_pending()) {
+    fb_reset();
+    return 0;
+  }
+  int caps = atomic_load_explicit(&term_caps, memory_order_relaxed);
+  if (caps & (TERM_SYNC | TERM_REP)) { /* TERMINAL PROBE */
+    static char *out = NULL;
+    static size_t out_cap = 0;
+    size_t need = fbuf_len + sizeof(TERM_BSU TERM_ESU);
+    if (need > out_cap) {
+      char *tmp = realloc(out, need);
+      if (tmp) {
+        out = tmp;
+        out_cap = need;
+      }
+    }
+    if (need <= out_cap) {
+      size_t n = 0;
+      if (caps & TERM_SYNC) {
+        memcpy(out, TERM_BSU, sizeof(TERM_BSU) - 1);
+        n = sizeof(TERM_BSU) - 1;
+      }
+      if (caps & TERM_REP)
+        n += term_rep_pack(fbuf, fbuf_len, out + n);
+      else {
+        memcpy(out + n, fbuf, fbuf_len);
+        n += fbuf_len;
+      }
+      if (caps & TERM_SYNC) {
+        memcpy(out + n, TERM_ESU, sizeof(TERM_ESU) - 1);
+        n += sizeof(TERM_ESU) - 1;
+      }
+      xwrite(out, n);
+      fbuf_len = 0;
+    }
+  }
+  fb_flush();
+  if (boot_ns)
+    boot_log();
+  if (!key_ns)
+    return 1;
+  if (key_log == -2) {
+    const char *path = getenv("TUTOR_LATENCY_LOG");
+    key_log = path && *path ? open(path, O_WRONLY | O_APPEND | O_CREAT |
+                                             O_CLOEXEC, 0644)
+                            : -1;
+  }
+  if (key_log >= 0)
+    dprintf(key_log, "%lld\n", (long long)(now_ns() - key_ns) / 1000);
+  key_ns = 0;
+  return 1;
+}
+
+/* клавиша для навигации: раскладка не важна */
+static int read_key(void) { return tv_qwerty(read_key_raw()); }
+
+/* ══════════════════════════════════════════════════════════════════════
+   SPECULATIVE FLATTEN
+   Курсор меню стоит на пункте — дальше почти всегда l/Enter. Поток-
+   воркер заранее строит flat этого пункта вместе с поисковым индексом
+   и публикует его атомарной заменой указателя; flat_open забирает
+   готовое тем же atomic_exchange. UI воркера не ждёт: запрос — sem_post,
+   не успел — tv_flat_build как раньше. Ждать приходится только перед
+   сменой контента (reload, Tab): воркер читает строки секций.
+   ══════════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+  const char **sec; /* для чего построено — только сравнение */
+  unsigned gen;
+  TvFlat f;
+} SpecFlat;
+
+static sem_t spec_sem;
+static pthread_mutex_t spec_mu = PTHREAD_MUTEX_INITIALIZER; /* держит сборку */
+static _Atomic(const char **) spec_want = NULL;
+static _Atomic(SpecFlat *) spec_ready = NULL;
+static atomic_uint spec_gen = 0; /* растёт при смене контента */
+static int spec_started = 0;
+static const char **spec_asked = NULL; /* последний запрос UI */
+
+static void spec_free(SpecFlat *p) {
+  if (!p)
+    return;
+  tv_flat_release(&p->f);
+  free(p);
+}
+
+static void *spec_worker(void *arg) {
+  (void)arg;
+  while (1) {
+    while (sem_wait(&spec_sem) != 0)
+      ;
+    pthread_mutex_lock(&spec_mu);
+    const char **sec = atomic_exchange(&spec_want, NULL);
+    SpecFlat *p = sec ? calloc(1, sizeof(*p)) : NULL;
+    if (p) {
+      p->sec = sec;
+      p->gen = atomic_load(&spec_gen);
+      tv_flat_build(&p->f, tutor, sec);
+      for (int i = 0; i < p->f.n; i++)
+        p->f.v[i].srch = tv_search_index(p->f.v[i].text);
+    }
+    pthread_mutex_unlock(&spec_mu);
+    if (p)
+      spec_free(atomic_exchange(&spec_ready, p));
+  }
+  return NULL;
+}
+
+/* курсор меню встал на sec: построить его flat в фоне. spec_ready
+   UI не разыменовывает, пока не забрал: воркер освобождает вытесненное */
+static void spec_request(const char **sec) {
+  if (sec == spec_asked)
+    return; /* уже строится или готово */
+  if (!spec_started) {
+    pthread_t t;
+    spec_started = sem_init(&spec_sem, 0, 0) == 0 &&
+                           pthread_create(&t, NULL, spec_worker, NULL) == 0
+                       ? 1
+                       : -1;
+    if (spec_started > 0)
+      pthread_detach(t);
+  }
+  if (spec_started < 0)
+    return;
+  spec_asked = sec;
+  atomic_store(&spec_want, sec);
+  sem_post(&spec_sem);
+}
+
+/* перед сменой контента: дождаться текущей сборки, всё готовое —
+   в утиль (сравнение по указателю после free обмануло бы) */
+static void spec_quiesce(void) {
+  atomic_store(&spec_want, NULL);
+  spec_asked = NULL;
+  pthread_mutex_lock(&spec_mu);
+  atomic_fetch_add(&spec_gen, 1);
+  pthread_mutex_unlock(&spec_mu);
+  spec_free(atomic_exchange(&spec_ready, NULL));
+}
+
+/* готовый flat для sec → в f; 0 — нет такого */
+static int spec_take(TvFlat *f, const char **sec) {
+  SpecFlat *p = atomic_exchange(&spec_ready, NULL), *none = NULL;
+  if (!p)
+    return 0;
+  if (p->gen != atomic_load(&spec_gen)) {
+    spec_free(p);
+    return 0;
+  }
+  if (p->sec != sec) {
+    /* чужой — вернуть, если воркер тем временем не опубликовал новый */
+    if (!atomic_compare_exchange_strong(&spec_ready, &none, p))
+      spec_free(p);
+    return 0;
+  }
+  spec_asked = NULL; /* вернёмся в меню — строить заново */
+  tv_flat_release(f);
+  unsigned gen = f->gen; /* растёт и при подмене целиком */
+  *f = p->f;
+  f->gen = gen + 1;
+  free(p);
+  return 1;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   HISTORY
+   Append-only лог $XDG_STATE_HOME/tutor/<tutor>.log из записей по 16
+   байт: курсор задержался на R:-строке или на ней нажали Enter. При
+   старте читается одним mmap; когда записей становится много, лог
+   сжимается до одной записи на строку.
+   ══════════════════════════════════════════════════════════════════════ */
+
+enum { HIST_DWELL = 1, HIST_SELECT = 2, HIST_MERGED = 3 };
+
+#define HIST_DWELL_MS 1500   /* столько курсор должен простоять на строке */
+#define HIST_COMPACT_AT 4096 /* записей в логе, после которых он сжимается */
+#define HIST_KEEP 512        /* строк, переживающих сжатие */
+#define HIST_TOP 20          /* строк в «Недавних» */
+#define SEC_RECENT (-1)      /* view_section: псевдо-секция «Недавние» */
+#define SEC_DETAIL (-2)      /* …и страница подробностей (DETAIL PAGES) */
+#define SEC_FILTER (-4)      /* …и совпадения -w (FILTER) */
+
+typedef struct {
+  uint32_t hash;  /* key_hash ключа R:-строки */
+  uint32_t ts;    /* unix time (у сжатой записи — последнего события) */
+  uint16_t sec;   /* где строка была в момент записи — подсказка */
+  uint16_t line;
+  uint16_t count; /* 1 у событий, накопленный вес у HIST_MERGED */
+  uint8_t kind;
+  uint8_t pad;
+} HistRec;
+
+_Static_assert(sizeof(HistRec) == 16, "формат лога — 16 байт на запись");
+
+static int hist_fd = -1;
+
+/* «Недавние»: строки указывают в исходные секции */
+static const char *recent_sec[HIST_TOP + 2];
+static uint32_t recent_src[HIST_TOP + 2]; /* (секция << 16) | строка */
+static int recent_n = 0;
+static char recent_label[256];
+
+/* совпадения -w (FILTER) — так же, указатели в исходные секции */
+static const char **filter_sec = NULL;
+static uint32_t *filter_src = NULL;
+
+static unsigned key_hash(const char *s, size_t n, unsigned seed) {
+  unsigned h = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (size_t i = 0; i < n; i++)
+    h = (h ^ (unsigned char)s[i]) * 16777619u;
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+/* строку узнаём по ключу: правка описания не сбрасывает историю */
+static uint32_t row_hash(const char *line) {
+  const char *key = line + 2;
+  return key_hash(key, strcspn(key, "|"), 0);
+}
+
+/* $env/tutor/name, либо ~/fallback/tutor/name */
+static int xdg_path(const char *env, const char *fallback, const char *name,
+                    char *out, size_t cap) {
+  const char *base = getenv(env);
+  const char *home = getenv("HOME");
+  int n;
+  if (base && *base)
+    n = snprintf(out, cap, "%s/tutor/%s", base, name);
+  else if (home && *home)
+    n = snprintf(out, cap, "%s/%s/tutor/%s", home, fallback, name);
+  else
+    return -1;
+  return n > 0 && (size_t)n < cap ? 0 : -1;
+}
+
+/* то же для файлов текущего пакета: tutor/gitutor.log, tutor/gitutor.pack */
+static int tutor_path(const char *env, const char *fallback, const char *ext,
+                     char *out, size_t cap) {
+  char name[64];
+  snprintf(name, sizeof(name), "%s%s", tutor->name, ext);
+  return xdg_path(env, fallback, name, out, cap);
+}
+
+static void mkdir_parents(const char *path) {
+  char dir[1024];
+  snprintf(dir, sizeof(dir), "%s", path);
+  for (char *p = dir + 1; *p; p++) {
+    if (*p != '/')
+      continue;
+    *p = '\0';
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+      return;
+    *p = '/';
+  }
+}
+
+static void hist_event(int kind, const char *line, int sec, int idx) {
+  if (line[0] != 'R')
+    return;
+  char path[1024];
+  if (tutor_path("XDG_STATE_HOME", ".local/state", ".log", path,
+               sizeof(path)) != 0)
+    return;
+  /* LOCK_SH против hist_compact: пока держим, лог не подменят; если
+     подменили раньше (st_nlink == 0), пишем уже в новый файл */
+  for (int tries = 0; tries < 4; tries++) {
+    if (hist_fd < 0) {
+      mkdir_parents(path);
+      hist_fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+      if (hist_fd < 0)
+        return;
+    }
+    struct stat st;
+    if (flock(hist_fd, LOCK_SH) == 0 && fstat(hist_fd, &st) == 0 &&
+        st.st_nlink > 0)
+      break;
+    close(hist_fd); /* закрытие снимает и блокировку */
+    hist_fd = -1;
+  }
+  if (hist_fd < 0)
+    return;
+  HistRec r = {row_hash(line), (uint32_t)time(NULL), (uint16_t)sec,
+               (uint16_t)idx,  1,    (uint8_t)kind,      0};
+  /* O_APPEND + один write на запись — параллельные tutor'ы не мешают */
+  ssize_t w = write(hist_fd, &r, sizeof(r));
+  (void)w;
+  flock(hist_fd, LOCK_UN);
+}
+
+/* событие на строке line секции, открытой в view_section */
+static void view_event(int kind, const char **sec, int sec_idx, int line) {
+  if (sec_idx == SEC_RECENT)
+    hist_event(kind, sec[line], (int)(recent_src[line] >> 16),
+               (int)(recent_src[line] & 0xffff));
+  else if (sec_idx == SEC_FILTER)
+    hist_event(kind, sec[line], (int)(filter_src[line] >> 16),
+               (int)(filter_src[line] & 0xffff));
+  else
+    hist_event(kind, sec[line], sec_idx, line);
+}
+
+static long now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   TERMINAL PROBE
+   Что умеет терминал (terminal caps), спрашиваем один раз: ответ
+   кэшируется в $XDG_STATE_HOME/tutor/terminals по $TERM/$TERM_PROGRAM,
+   и следующие запуски обходятся без запросов. Файл текстовый, строка
+   на терминал: TERM, TERM_PROGRAM, caps (hex), XTVERSION через табы;
+   удалить строку — опросить заново. Опрос асинхронный: ответы читает
+   поток ввода, UI не ждёт. Ждём только на выходе, и не дольше
+   TERM_PROBE_MS от запроса — иначе опоздавший ответ достался бы шеллу.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define TERM_PROBE_MS 150
+
+static char term_id[96];          /* "TERM\tTERM_PROGRAM"; демон — клиента */
+static int64_t term_probe_ns = 0; /* когда ушёл TERM_QUERY, 0 — не уходил */
+
+static const char *term_key(void) {
+  if (!term_id[0]) {
+    const char *t = getenv("TERM"), *p = getenv("TERM_PROGRAM");
+    snprintf(term_id, sizeof(term_id), "%s\t%s", t ? t : "", p ? p : "");
+  }
+  return term_id;
+}
+
+/* caps | TERM_KNOWN из кэша, 0 — терминал там не встречался */
+static int term_cache_load(void) {
+  char path[1024], buf[8192];
+  if (xdg_path("XDG_STATE_HOME", ".local/state", "terminals", path,
+               sizeof(path)) != 0)
+    return 0;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+  ssize_t n = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (n <= 0)
+    return 0;
+  buf[n] = '\0';
+  const char *key = term_key();
+  size_t klen = strlen(key);
+  int caps = 0;
+  const char *l = buf;
+  while (l && *l) {
+    if (strncmp(l, key, klen) == 0 && l[klen] == '\t') /* последняя — свежее */
+      caps = (int)strtol(l + klen + 1, NULL, 16) | TERM_KNOWN;
+    if ((l = strchr(l, '\n')))
+      l++;
+  }
+  return caps;
+}
+
+static void term_cache_save(int caps) {
+  char path[1024], line[256];
+  if (xdg_path("XDG_STATE_HOME", ".local/state", "terminals", path,
+               sizeof(path)) != 0)
+    return;
+  mkdir_parents(path);
+  int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+  int n = snprintf(line, sizeof(line), "%s\t%x\t%s\n", term_key(),
+                   caps & ~TERM_KNOWN, term_version);
+  /* O_APPEND + один write — как у HISTORY */
+  ssize_t w = write(fd, line, n < (int)sizeof(line) ? (size_t)n : 0);
+  (void)w;
+  close(fd);
+}
+
+/* term_raw + caps: из кэша, а нет там — запросы вслед за ALT_ON */
+static void term_open(void) {
+  term_raw();
+  if (atomic_load_explicit(&term_caps, memory_order_relaxed) & TERM_KNOWN)
+    return; /* уже открывали в этом процессе */
+  int caps = term_cache_load();
+  if (caps) {
+    atomic_store_explicit(&term_caps, caps, memory_order_relaxed);
+    return;
+  }
+  if (term_probe_ns || !isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO))
+    return;
+  xwrite(TERM_QUERY, sizeof(TERM_QUERY) - 1);
+  term_probe_ns = now_ns();
+}
+
+/* term_restore, но сперва дождаться ответов на TERM_QUERY: пока
+   терминал в raw, они не попадут на экран эхом */
+static void term_close(void) {
+  if (term_probe_ns) {
+    int64_t end = term_probe_ns + TERM_PROBE_MS * 1000000LL;
+    int caps;
+    while (!((caps = atomic_load_explicit(&term_caps, memory_order_acquire)) &
+             TERM_KNOWN)) {
+      int64_t left = end - now_ns();
+      if (left <= 0)
+        break;
+      if (key_started > 0) /* читает поток ввода */
+        usleep(1000);
+      else if (!wait_byte((int)(left / 1000)) || key_decode() < 0)
+        break;
+    }
+    if (caps & TERM_KNOWN)
+      term_cache_save(caps);
+    else /* не ответил: хвост ответа выбросить, в кэш не писать */
+      tcflush(STDIN_FILENO, TCIFLUSH);
+    term_probe_ns = 0;
+  }
+  term_restore();
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   COMPRESSION
+   LZ77 с общим словарём, поверх — статический Huffman, общий на pack.
+   Словарь как бы стоит перед каждой секцией, так что даже короткая
+   секция ссылается на общие куски ("\0R:git ", повторяющиеся описания).
+   Сжатая секция — один битовый поток LSB-first из последовательностей:
+     token     [литералы:4 | совпадение-4:4], 15 — длина продолжается
+               байтами EXT, пока байт == 255
+     литералы  по байту
+     offset    младший и старший байт, 1..65535 назад (в т.ч. в словарь)
+   Последняя последовательность — только литералы, без offset. У каждого
+   поля своя таблица кодов (HT_*): распределения у них совсем разные.
+   Словарь и длины кодов тренирует --pack (lz_train, huff_lengths):
+   для словаря берутся куски, 8-граммы которых встречаются в наибольшем
+   числе секций, коды — по частотам полей всех секций.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define LZ_MIN 4            /* минимальное совпадение */
+#define LZ_WINDOW 65535     /* дальше offset не дотянется */
+#define LZ_HASH_BITS 15
+#define LZ_CHAIN 64         /* кандидатов на позицию при сжатии */
+#define LZ_DICT_MAX (16 << 10)
+#define LZ_SEG 48           /* длина куска словаря */
+#define LZ_DMER 8
+#define HUFF_MAX 12         /* предельная длина кода = биты таблицы */
+
+enum { HT_TOK, HT_LIT, HT_EXT, HT_OLO, HT_OHI, HT_N };
+
+static uint8_t huff_len[HT_N][256];
+static uint16_t huff_dec[HT_N][1 << HUFF_MAX]; /* sym | len << 8, 0 — дыра */
+static int huff_ready = 0;
+
+/* канонические коды, уже развёрнутые под LSB-first */
+static void huff_codes(const uint8_t *len, uint16_t *code) {
+  unsigned count[HUFF_MAX + 1] = {0}, next[HUFF_MAX + 2];
+  for (int s = 0; s < 256; s++)
+    count[len[s]]++;
+  count[0] = 0;
+  next[1] = 0;
+  for (int b = 1; b <= HUFF_MAX; b++)
+    next[b + 1] = (next[b] + count[b]) << 1;
+  for (int s = 0; s < 256; s++) {
+    unsigned c = len[s] ? next[len[s]]++ : 0, r = 0;
+    for (int b = 0; b < len[s]; b++)
+      r |= ((c >> b) & 1) << (len[s] - 1 - b);
+    code[s] = (uint16_t)r;
+  }
+}
+
+/* → 0, или -1, если длины не образуют префиксный код */
+static int huff_table(const uint8_t *len, uint16_t *dec) {
+  uint16_t code[256];
+  unsigned kraft = 0;
+  for (int s = 0; s < 256; s++) {
+    if (len[s] > HUFF_MAX)
+      return -1;
+    kraft += len[s] ? 1u << (HUFF_MAX - len[s]) : 0;
+  }
+  if (kraft > 1u << HUFF_MAX)
+    return -1;
+  huff_codes(len, code);
+  memset(dec, 0, sizeof(huff_dec[0]));
+  for (int s = 0; s < 256; s++)
+    for (unsigned i = code[s]; len[s] && i < 1u << HUFF_MAX; i += 1u << len[s])
+      dec[i] = (uint16_t)(s | len[s] << 8);
+  return 0;
+}
+
+#define HUFF_PACKED (HT_N * 128) /* длины всех таблиц по 4 бита */
+
+static void huff_store(uint8_t *out) {
+  for (int t = 0; t < HT_N; t++)
+    for (int s = 0; s < 256; s += 2)
+      out[t * 128 + s / 2] = (uint8_t)(huff_len[t][s] | huff_len[t][s + 1] << 4);
+}
+
+/* → 0, или -1, если таблицы в pack'е негодные */
+static int huff_load(const uint8_t *in) {
+  for (int t = 0; t < HT_N; t++) {
+    for (int s = 0; s < 256; s += 2) {
+      huff_len[t][s] = in[t * 128 + s / 2] & 15;
+      huff_len[t][s + 1] = in[t * 128 + s / 2] >> 4;
+    }
+    if (huff_table(huff_len[t], huff_dec[t]) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+/* длины кодов по частотам; если дерево глубже HUFF_MAX — частоты
+   сглаживаются и всё повторяется. freq — у всех 256 символов >= 1 */
+static void huff_lengths(const uint32_t *freq, uint8_t *len) {
+  uint64_t f[512];
+  int parent[512];
+  for (int s = 0; s < 256; s++)
+    f[s] = freq[s];
+  for (;;) {
+    int n = 256, alive[512];
+    for (int i = 0; i < 256; i++)
+      alive[i] = 1;
+    for (; n < 511; n++) {
+      int a = -1, b = -1;
+      for (int i = 0; i < n; i++) {
+        if (!alive[i])
+          continue;
+        if (a < 0 || f[i] < f[a]) {
+          b = a;
+          a = i;
+        } else if (b < 0 || f[i] < f[b]) {
+          b = i;
+        }
+      }
+      f[n] = f[a] + f[b];
+      alive[a] = alive[b] = 0;
+      alive[n] = 1;
+      parent[a] = parent[b] = n;
+    }
+    int deepest = 0;
+    for (int s = 0; s < 256; s++) {
+      int d = 0;
+      for (int i = s; i != 510; i = parent[i])
+        d++;
+      len[s] = (uint8_t)d;
+      if (d > deepest)
+        deepest = d;
+    }
+    if (deepest <= HUFF_MAX)
+      return;
+    for (int s = 0; s < 256; s++)
+      f[s] = f[s] / 2 + 1;
+  }
+}
+
+typedef struct {
+  const unsigned char *p, *end;
+  uint64_t acc;
+  int n;
+} BitIn;
+
+static int bit_sym(BitIn *b, int t) {
+  while (b->n <= 56 && b->p < b->end) {
+    b->acc |= (uint64_t)*b->p++ << b->n;
+    b->n += 8;
+  }
+  unsigned e = huff_dec[t][b->acc & ((1u << HUFF_MAX) - 1)];
+  int l = e >> 8;
+  if (!l || l > b->n)
+    return -1;
+  b->acc >>= l;
+  b->n -= l;
+  return e & 0xff;
+}
+
+/* длина с продолжением: v уже из токена; -1 — поток кончился */
+static long bit_len(BitIn *b, size_t v) {
+  int c;
+  do {
+    if ((c = bit_sym(b, HT_EXT)) < 0)
+      return -1;
+    v += (size_t)c;
+  } while (c == 255);
+  return (long)v;
+}
+
+/* → 0, или -1, если поток битый; out — ровно raw байт */
+static int lz_decode(const unsigned char *in, size_t n,
+                     const unsigned char *dict, size_t dn, unsigned char *out,
+                     size_t raw) {
+  BitIn b = {in, in + n, 0, 0};
+  size_t pos = 0;
+  if (huff_ready != 1)
+    return -1;
+  while (pos < raw) {
+    int tok = bit_sym(&b, HT_TOK);
+    if (tok < 0)
+      return -1;
+    long lit = tok >> 4, len = (tok & 15) + LZ_MIN;
+    if (lit == 15 && (lit = bit_len(&b, 15)) < 0)
+      return -1;
+    if ((size_t)lit > raw - pos)
+      return -1;
+    for (; lit; lit--) {
+      int c = bit_sym(&b, HT_LIT);
+      if (c < 0)
+        return -1;
+      out[pos++] = (unsigned char)c;
+    }
+    if (pos == raw)
+      break;
+
+    int lo = bit_sym(&b, HT_OLO), hi = bit_sym(&b, HT_OHI);
+    if (lo < 0 || hi < 0)
+      return -1;
+    size_t off = (size_t)lo | (size_t)hi << 8;
+    if (len == 15 + LZ_MIN && (len = bit_len(&b, (size_t)len)) < 0)
+      return -1;
+    if (off == 0 || off > pos + dn || (size_t)len > raw - pos)
+      return -1;
+    for (; len && off > pos; len--, pos++) /* начало — из словаря */
+      out[pos] = dict[dn - (off - pos)];
+    for (; len; len--, pos++) /* перекрытие допустимо: побайтно */
+      out[pos] = out[pos - off];
+  }
+  return 0;
+}
+
+/* поток символов кодера: таблица << 8 | байт */
+#define SYM(t, c) ((uint16_t)((t) << 8 | (c)))
+
+static uint16_t *lz_put_len(uint16_t *o, size_t v) {
+  for (; v >= 255; v -= 255)
+    *o++ = SYM(HT_EXT, 255);
+  *o++ = SYM(HT_EXT, v);
+  return o;
+}
+
+static uint16_t *lz_put_seq(uint16_t *o, const unsigned char *lit,
+                            size_t nlit, size_t off, size_t len) {
+  size_t ml = len ? len - LZ_MIN : 0;
+  *o++ = SYM(HT_TOK, (nlit < 15 ? nlit : 15) << 4 | (ml < 15 ? ml : 15));
+  if (nlit >= 15)
+    o = lz_put_len(o, nlit - 15);
+  for (size_t i = 0; i < nlit; i++)
+    *o++ = SYM(HT_LIT, lit[i]);
+  if (!len)
+    return o;
+  *o++ = SYM(HT_OLO, off & 0xff);
+  *o++ = SYM(HT_OHI, off >> 8);
+  if (ml >= 15)
+    o = lz_put_len(o, ml - 15);
+  return o;
+}
+
+static unsigned lz_hash4(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* с запасом на худший случай: символов на секцию из n байт */
+static size_t lz_bound(size_t n) { return n + n / 64 + 16; }
+
+static size_t lz_match(const unsigned char *buf, size_t total, size_t i,
+                       const int32_t *head, const int32_t *prev,
+                       size_t *off) {
+  size_t best = 0;
+  int32_t c = head[lz_hash4(buf + i)];
+  for (int k = 0; c >= 0 && k < LZ_CHAIN && i - (size_t)c <= LZ_WINDOW;
+       k++, c = prev[c]) {
+    size_t l = 0;
+    while (i + l < total && buf[c + l] == buf[i + l])
+      l++;
+    if (l > best) {
+      best = l;
+      *off = i - (size_t)c;
+    }
+  }
+  return best;
+}
+
+/* src[n] со словарём dict[dn] → символы в sym, возвращает их число.
+   Разбор ленивый: если со следующей позиции совпадение длиннее,
+   текущий байт уходит литералом. */
+static size_t lz_encode(const unsigned char *src, size_t n,
+                        const unsigned char *dict, size_t dn, uint16_t *sym) {
+  size_t total = dn + n;
+  unsigned char *buf = malloc(total + 1);
+  int32_t *head = malloc(sizeof(int32_t) << LZ_HASH_BITS);
+  int32_t *prev = malloc((total + 1) * sizeof(int32_t));
+  uint16_t *o = sym;
+  size_t i = dn, anchor = dn;
+  if (!buf || !head || !prev) { /* без памяти — всё литералами */
+    o = lz_put_seq(o, src, n, 0, 0);
+    goto done;
+  }
+  memcpy(buf, dict, dn);
+  memcpy(buf + dn, src, n);
+  memset(head, 0xff, sizeof(int32_t) << LZ_HASH_BITS);
+
+#define LZ_INSERT(p)                                                           \
+  do {                                                                         \
+    if ((p) + LZ_MIN <= total) {                                               \
+      unsigned h_ = lz_hash4(buf + (p));                                       \
+      prev[p] = head[h_];                                                      \
+      head[h_] = (int32_t)(p);                                                 \
+    }                                                                          \
+  } while (0)
+  for (size_t k = 0; k < dn; k++)
+    LZ_INSERT(k);
+  while (i + LZ_MIN <= total) {
+    size_t off = 0, off2 = 0;
+    size_t best = lz_match(buf, total, i, head, prev, &off);
+    LZ_INSERT(i);
+    if (best < LZ_MIN ||
+        (i + 1 + LZ_MIN <= total &&
+         lz_match(buf, total, i + 1, head, prev, &off2) > best)) {
+      i++;
+      continue;
+    }
+    o = lz_put_seq(o, buf + anchor, i - anchor, off, best);
+    for (size_t e = i + best, k = i + 1; k < e; k++)
+      LZ_INSERT(k);
+    anchor = i += best;
+  }
+#undef LZ_INSERT
+  if (anchor < total)
+    o = lz_put_seq(o, buf + anchor, total - anchor, 0, 0);
+done:
+  free(buf);
+  free(head);
+  free(prev);
+  return (size_t)(o - sym);
+}
+
+/* символы → битовый поток кодами huff_len, возвращает длину в байтах */
+static size_t lz_pack(const uint16_t *sym, size_t n, unsigned char *out) {
+  uint16_t code[HT_N][256];
+  for (int t = 0; t < HT_N; t++)
+    huff_codes(huff_len[t], code[t]);
+  unsigned char *o = out;
+  uint64_t acc = 0;
+  int bits = 0;
+  for (size_t i = 0; i < n; i++) {
+    int t = sym[i] >> 8, c = sym[i] & 0xff;
+    acc |= (uint64_t)code[t][c] << bits;
+    bits += huff_len[t][c];
+    for (; bits >= 8; bits -= 8, acc >>= 8)
+      *o++ = (unsigned char)acc;
+  }
+  if (bits)
+    *o++ = (unsigned char)acc;
+  return (size_t)(o - out);
+}
+
+/* Словарь в духе COVER: для каждого 8-грамма — в скольких секциях он
+   встречается; выборка делится на эпохи, из каждой берётся кусок
+   LZ_SEG байт с наибольшей суммой, его 8-граммы дальше не считаются.
+   src — секции подряд, ends[i] — конец i-й. → размер словаря */
+static size_t lz_train(const unsigned char *src, const size_t *ends, int nsec,
+                       unsigned char *dict, size_t cap) {
+  size_t total = nsec ? ends[nsec - 1] : 0;
+  uint16_t *cnt = calloc(1 << 16, sizeof(uint16_t));
+  uint16_t *seen = calloc(1 << 16, sizeof(uint16_t));
+  size_t dn = 0;
+  if (!cnt || !seen || total < LZ_SEG * 2)
+    goto done;
+
+#define DMER(p) ((unsigned)(key_hash((const char *)(p), LZ_DMER, 0) & 0xffff))
+  for (int s = 0, a = 0; s < nsec; a = (int)ends[s++])
+    for (size_t i = (size_t)a; i + LZ_DMER <= ends[s]; i++) {
+      unsigned h = DMER(src + i);
+      if (seen[h] != s + 1) {
+        seen[h] = (uint16_t)(s + 1);
+        cnt[h] += cnt[h] < 0xffff;
+      }
+    }
+  for (unsigned h = 0; h < 1 << 16; h++)
+    cnt[h] = cnt[h] > 1 ? cnt[h] - 1 : 0; /* из одной секции — не нужен */
+
+  size_t epochs = cap / LZ_SEG, step = total / (epochs ? epochs : 1);
+  if (step < LZ_SEG)
+    step = LZ_SEG;
+  for (size_t a = 0; a + LZ_SEG <= total && dn + LZ_SEG <= cap; a += step) {
+    size_t b = a + step < total ? a + step : total;
+    size_t best = 0, best_at = 0, sum = 0;
+    for (size_t i = a; i + LZ_DMER <= b; i++) {
+      sum += cnt[DMER(src + i)];
+      if (i >= a + LZ_SEG - LZ_DMER + 1)
+        sum -= cnt[DMER(src + i - (LZ_SEG - LZ_DMER + 1))];
+      if (sum > best && i + LZ_DMER >= a + LZ_SEG) {
+        best = sum;
+        best_at = i + LZ_DMER - LZ_SEG;
+      }
+    }
+    if (!best)
+      continue;
+    memcpy(dict + dn, src + best_at, LZ_SEG);
+    dn += LZ_SEG;
+    for (size_t i = best_at; i + LZ_DMER <= best_at + LZ_SEG; i++)
+      cnt[DMER(src + i)] = 0;
+  }
+#undef DMER
+done:
+  free(cnt);
+  free(seen);
+  return dn;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   CONTENT FILES
+   $XDG_DATA_HOME/tutor/<tutor>/<id>.tut — тот же формат, что и таблицы
+   выше: по строке T:/G:/R:/C:/N:/B:, плюс M:подпись для меню; пустые
+   строки и # — пропускаются. Файл с id встроенной секции заменяет её,
+   остальные добавляются в конец по имени файла. Встроенные таблицы —
+   запасной вариант, если файла нет или он пуст.
+   Файл читается одним read() в буфер, который и становится хранилищем
+   строк: один проход memchr режет его на месте, без промежуточных копий.
+
+   --pack компилирует каталог в $XDG_DATA_HOME/tutor/<tutor>.pack:
+
+     PackHeader   magic, версия, размеры, контрольная сумма всего, кроме data
+     PackSection  [nsec]   id, label (смещения в heap), строки, сжатие
+     LineRec      [nlines] off, len, kind — строка "K:текст\0" в heap
+     huff         [HUFF_PACKED] длины кодов Huffman (см. COMPRESSION)
+     dict         [dict_size]  общий словарь LZ
+     heap         [heap_size]
+     data         [data_size]  секции, сжатые каждая отдельно
+
+   Порядок байт — родной, pack не переносится между архитектурами.
+   Pack мапится read-only; для меню хватает id и label из heap. Таблица
+   строк секции строится при первом обращении: у несжатой — указатели
+   прямо в mapping, сжатая распаковывается один раз и остаётся в памяти.
+   Если какой-то .tut новее pack'а, pack игнорируется и каталог
+   разбирается как текст.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define SECTIONS_MAX 64
+#define CONTENT_MAX (4 << 20) /* больше — явно не шпаргалка */
+
+#define PACK_MAGIC "TUTPACK"
+#define PACK_VERSION 2
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t nsec;
+  uint32_t nlines;    /* LineRec — только у несжатых секций */
+  uint32_t heap_size;
+  uint32_t dict_size;
+  uint32_t data_size; /* сжатые секции, у каждой своя сумма */
+  uint64_t sum;       /* pack_sum таблиц, словаря и heap */
+} PackHeader;
+
+typedef struct {
+  uint32_t id, label; /* смещения в heap */
+  uint32_t first, n;  /* диапазон LineRec; у сжатой — только n */
+  uint32_t raw;       /* размер после распаковки, 0 — не сжата */
+  uint32_t zoff, zsize;
+  uint32_t zsum; /* младшие 32 бита pack_sum сжатых байт */
+} PackSection;
+
+typedef struct {
+  uint32_t off;
+  uint16_t len; /* без '\0' */
+  uint8_t kind; /* == heap[off] */
+  uint8_t pad;
+} LineRec;
+
+_Static_assert(sizeof(PackHeader) == 40, "PackHeader layout");
+_Static_assert(sizeof(PackSection) == 32, "PackSection layout");
+_Static_assert(sizeof(LineRec) == 8, "LineRec layout");
+
+typedef struct {
+  const char *id;
+  const char *label;
+  const char **lines; /* NULL-terminated, как sec_*; у pack — лениво */
+  const LineRec *recs; /* pack: строки несжатой секции в mapping'е */
+  const char *heap;
+  uint32_t n;
+  const unsigned char *z; /* pack: сжатая секция в mapping'е */
+  uint32_t zsize, raw, zsum;
+  int from_file; /* .tut или pack, а не встроенная таблица */
+  uint64_t sig;  /* хэш исходника для RENDER CACHE, у встроенных 0 */
+} Section;
+
+static Section sections[SECTIONS_MAX];
+static int nsections = 0;
+static int content_external = 0; /* хоть одна секция пришла из файла */
+static const unsigned char *pack_dict = NULL;
+static size_t pack_dict_n = 0;
+static const uint8_t *pack_huff = NULL;
+
+/* buf[n] должен быть доступен: туда пишется '\0' последней строки */
+static const char **content_parse(char *buf, size_t n, const char **label) {
+  size_t cap = 64, cnt = 0;
+  const char **lines = malloc(cap * sizeof(*lines));
+  char *p = buf, *end = buf + n;
+
+  *label = NULL;
+  while (lines && p <= end) {
+    char *eol = memchr(p, '\n', (size_t)(end - p));
+    if (!eol)
+      eol = end;
+    *eol = '\0';
+    if (eol > p && eol[-1] == '\r')
+      eol[-1] = '\0';
+
+    if (p[0] == 'M' && p[1] == ':') {
+      *label = p + 2;
+    } else if (p[0] && p[1] == ':' && strchr("TGRCNB", p[0])) {
+      if (cnt + 2 > cap) {
+        const char **tmp = realloc(lines, (cap *= 2) * sizeof(*lines));
+        if (!tmp)
+          break;
+        lines = tmp;
+      }
+      lines[cnt++] = p;
+    }
+    p = eol + 1;
+  }
+  if (lines && cnt == 0) {
+    free(lines);
+    return NULL;
+  }
+  if (lines)
+    lines[cnt] = NULL;
+  return lines;
+}
+
+static int content_load_file(int dfd, const char *name, Section *out) {
+  int fd = openat(dfd, name, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  struct stat st;
+  char *buf = NULL;
+  size_t n = 0;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+      st.st_size < CONTENT_MAX && (buf = malloc((size_t)st.st_size + 1))) {
+    ssize_t r;
+    while (n < (size_t)st.st_size &&
+           (r = read(fd, buf + n, (size_t)st.st_size - n)) > 0)
+      n += (size_t)r;
+  }
+  close(fd);
+
+  const char *label;
+  uint64_t sig = buf ? (uint64_t)key_hash(buf, n, 1) << 32 | key_hash(buf, n, 2)
+                     : 0;
+  const char **lines = buf ? content_parse(buf, n, &label) : NULL;
+  if (!lines) {
+    free(buf);
+    return -1;
+  }
+  /* буфер живёт до выхода: в него смотрят lines, id и label */
+  char *id = strndup(name, strlen(name) - 4);
+  if (!label)
+    label = lines[0][0] == 'T' ? lines[0] + 2 : id;
+  *out = (Section){id, label, lines, NULL, NULL, 0, NULL, 0, 0, 0, 1, sig};
+  return 0;
+}
+
+/* id совпал со встроенной секцией — заменить, иначе дописать в конец */
+static void section_put(const Section *s) {
+  int j = 0;
+  while (j < nsections && strcmp(sections[j].id, s->id))
+    j++;
+  if (j == SECTIONS_MAX)
+    return;
+  sections[j] = *s;
+  nsections += j == nsections;
+  content_external = 1;
+}
+
+/* 8 байт за шаг: pack читается при каждом запуске */
+static uint64_t pack_sum(const unsigned char *p, size_t n) {
+  uint64_t h = 0x9e3779b97f4a7c15ull, w;
+  for (; n >= 8; p += 8, n -= 8) {
+    memcpy(&w, p, 8);
+    h = (h ^ w) * 0x100000001b3ull;
+    h ^= h >> 29;
+  }
+  w = 0;
+  memcpy(&w, p, n);
+  h = (h ^ w ^ n) * 0x100000001b3ull;
+  return h ^ (h >> 32);
+}
+
+/* распаковать при первом открытии; битая секция — пустая */
+static const char **sec_unpack(Section *sec) {
+  char *raw = malloc((size_t)sec->raw + 1);
+  const char **lines = malloc((sec->n + 1) * sizeof(*lines));
+  if (!huff_ready)
+    huff_ready = huff_load(pack_huff) == 0 ? 1 : -1;
+  if (!raw || !lines || (uint32_t)pack_sum(sec->z, sec->zsize) != sec->zsum ||
+      lz_decode(sec->z, sec->zsize, pack_dict, pack_dict_n,
+                (unsigned char *)raw, sec->raw) != 0) {
+    free(raw);
+    free(lines);
+    return NULL;
+  }
+  raw[sec->raw] = '\0';
+  uint32_t n = 0;
+  for (char *p = raw, *end = raw + sec->raw; p < end && n < sec->n;
+       p += strlen(p) + 1)
+    if (p[0] && p[1] == ':')
+      lines[n++] = p;
+  lines[n] = NULL;
+  return lines;
+}
+
+static const char **sec_lines(int s) {
+  static const char *empty[] = {NULL};
+  Section *sec = &sections[s];
+  if (sec->lines)
+    return sec->lines;
+  if (sec->z) {
+    sec->lines = sec_unpack(sec);
+    return sec->lines ? sec->lines : (sec->lines = empty);
+  }
+
+  const char **lines = malloc((sec->n + 1) * sizeof(*lines));
+  if (!lines)
+    return empty;
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < sec->n; i++) {
+    const LineRec *r = &sec->recs[i];
+    /* границы проверены в pack_load, kind — тоже часть контракта */
+    if (r->len >= 2 && sec->heap[r->off] == r->kind)
+      lines[n++] = sec->heap + r->off;
+  }
+  lines[n] = NULL;
+  return sec->lines = lines;
+}
+
+static int pack_str_ok(const char *heap, uint32_t size, uint32_t off) {
+  return off < size && memchr(heap + off, '\0', size - off) != NULL;
+}
+
+static int pack_load(const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(PackHeader) ||
+      st.st_size > CONTENT_MAX) {
+    close(fd);
+    return -1;
+  }
+  size_t size = (size_t)st.st_size;
+  const unsigned char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return -1;
+
+  /* сжатые данные здесь не читаются: их сумма проверяется в sec_unpack,
+     и страницы неоткрытых секций так и не попадают в память */
+  const PackHeader *h = (const PackHeader *)map;
+  size_t at_recs = sizeof(*h) + (size_t)h->nsec * sizeof(PackSection);
+  size_t at_huff = at_recs + (size_t)h->nlines * sizeof(LineRec);
+  size_t at_dict = at_huff + HUFF_PACKED;
+  size_t at_heap = at_dict + h->dict_size;
+  size_t at_data = at_heap + h->heap_size;
+  if (memcmp(h->magic, PACK_MAGIC, 8) || h->version != PACK_VERSION ||
+      h->nsec > SECTIONS_MAX || at_data + h->data_size != size ||
+      h->sum != pack_sum(map + sizeof(*h), at_data - sizeof(*h)))
+    goto bad;
+  const PackSection *ps = (const PackSection *)(map + sizeof(*h));
+  const LineRec *recs = (const LineRec *)(map + at_recs);
+  const char *heap = (const char *)(map + at_heap);
+
+  for (uint32_t i = 0; i < h->nlines; i++)
+    if (!pack_str_ok(heap, h->heap_size, recs[i].off) ||
+        recs[i].len >= h->heap_size - recs[i].off ||
+        heap[recs[i].off + recs[i].len] != '\0')
+      goto bad;
+  for (uint32_t i = 0; i < h->nsec; i++)
+    if (!pack_str_ok(heap, h->heap_size, ps[i].id) ||
+        !pack_str_ok(heap, h->heap_size, ps[i].label) ||
+        (ps[i].raw ? ps[i].zoff > h->data_size ||
+                         ps[i].zsize > h->data_size - ps[i].zoff ||
+                         ps[i].n > ps[i].raw / 3 + 1
+                   : ps[i].first > h->nlines ||
+                         ps[i].n > h->nlines - ps[i].first))
+      goto bad;
+
+  /* mapping живёт до выхода: на него смотрят sections */
+  pack_huff = map + at_huff;
+  huff_ready = 0; /* таблицы прошлого pack'а не годятся */
+  pack_dict = map + at_dict;
+  pack_dict_n = h->dict_size;
+  for (uint32_t i = 0; i < h->nsec; i++) {
+    Section s = {heap + ps[i].id, heap + ps[i].label, NULL, NULL, heap,
+                 ps[i].n, NULL, 0, 0, 0, 1, h->sum};
+    if (ps[i].raw) {
+      s.z = map + at_data + ps[i].zoff;
+      s.zsize = ps[i].zsize;
+      s.raw = ps[i].raw;
+      s.zsum = ps[i].zsum;
+    } else {
+      s.recs = recs + ps[i].first;
+    }
+    section_put(&s);
+  }
+  return 0;
+
+bad:
+  munmap((void *)map, size);
+  return -1;
+}
+
+/* --pack: текущие секции из файлов → <tutor>.pack, через tmp + rename.
+   Секция сжимается, если это вообще что-то даёт, иначе лежит как есть. */
+static int pack_write(void) {
+  char path[1024], tmp[1100];
+  if (tutor_path("XDG_DATA_HOME", ".local/share", ".pack", path,
+               sizeof(path)) != 0)
+    return 1;
+
+  /* секции в их распакованном виде: "K:текст\0" подряд */
+  int from[SECTIONS_MAX], nsec = 0;
+  size_t ends[SECTIONS_MAX], total = 0;
+  fb_reset();
+  for (int s = 0; s < nsections; s++) {
+    if (!sections[s].from_file)
+      continue;
+    for (const char **l = sec_lines(s); *l; l++)
+      if (strlen(*l) <= 0xffff)
+        fb_appendn(*l, strlen(*l) + 1);
+    from[nsec] = s;
+    ends[nsec++] = total = fbuf_len;
+  }
+  unsigned char *src = malloc(total + 1);
+  unsigned char *dict = malloc(LZ_DICT_MAX);
+  uint16_t *sym = malloc((lz_bound(total) + (size_t)nsec * 16) * 2);
+  unsigned char *data = malloc(total * 2 + (size_t)nsec * 16);
+  LineRec *recs = malloc((total / 3 + 1) * sizeof(LineRec));
+  unsigned char *out = NULL;
+  int ok = 0;
+  if (!src || !dict || !sym || !data || !recs)
+    goto done;
+  memcpy(src, fbuf, total);
+
+  /* словарь больше 1/16 выборки окупиться не успевает */
+  size_t dn = lz_train(src, ends, nsec, dict,
+                       total / 16 < LZ_DICT_MAX ? total / 16 : LZ_DICT_MAX);
+
+  /* LZ всех секций, потом коды по частотам их символов */
+  size_t sym_at[SECTIONS_MAX + 1] = {0};
+  uint32_t freq[HT_N][256];
+  for (int i = 0; i < nsec; i++) {
+    size_t a = i ? ends[i - 1] : 0;
+    sym_at[i + 1] = sym_at[i] + lz_encode(src + a, ends[i] - a, dict, dn,
+                                          sym + sym_at[i]);
+  }
+  for (int t = 0; t < HT_N; t++)
+    for (int c = 0; c < 256; c++)
+      freq[t][c] = 1;
+  for (size_t i = 0; i < sym_at[nsec]; i++)
+    freq[sym[i] >> 8][sym[i] & 0xff]++;
+  for (int t = 0; t < HT_N; t++)
+    huff_lengths(freq[t], huff_len[t]);
+
+  PackSection ps[SECTIONS_MAX];
+  uint32_t nlines = 0, nz = 0;
+  size_t data_n = 0;
+  fb_reset(); /* теперь во fbuf копится heap */
+  for (int i = 0; i < nsec; i++) {
+    const Section *sec = &sections[from[i]];
+    size_t a = i ? ends[i - 1] : 0, len = ends[i] - a;
+    uint32_t n = 0;
+    for (size_t p = a; p < ends[i]; p += strlen((char *)src + p) + 1)
+      n++;
+    ps[i] = (PackSection){(uint32_t)fbuf_len, 0, nlines, n, 0, 0, 0, 0};
+    fb_appendn(sec->id, strlen(sec->id) + 1);
+    ps[i].label = (uint32_t)fbuf_len;
+    fb_appendn(sec->label, strlen(sec->label) + 1);
+
+    size_t zn = lz_pack(sym + sym_at[i], sym_at[i + 1] - sym_at[i],
+                        data + data_n);
+    if (zn < len) {
+      ps[i].raw = (uint32_t)len;
+      ps[i].zoff = (uint32_t)data_n;
+      ps[i].zsize = (uint32_t)zn;
+      ps[i].zsum = (uint32_t)pack_sum(data + data_n, zn);
+      data_n += zn;
+      nz++;
+      continue;
+    }
+    for (size_t p = a; p < ends[i]; p += strlen((char *)src + p) + 1) {
+      size_t l = strlen((char *)src + p);
+      recs[nlines++] = (LineRec){(uint32_t)fbuf_len, (uint16_t)l, src[p], 0};
+      fb_appendn((char *)src + p, l + 1);
+    }
+  }
+  if (!nz)
+    dn = 0;
+
+  PackHeader h = {PACK_MAGIC,         PACK_VERSION, (uint32_t)nsec, nlines,
+                  (uint32_t)fbuf_len, (uint32_t)dn, (uint32_t)data_n, 0};
+  size_t at_recs = sizeof(h) + (size_t)nsec * sizeof(PackSection);
+  size_t at_huff = at_recs + nlines * sizeof(LineRec);
+  size_t at_data = at_huff + HUFF_PACKED + dn + fbuf_len;
+  size_t size = at_data + data_n;
+  if (!(out = malloc(size)))
+    goto done;
+  memcpy(out + sizeof(h), ps, (size_t)nsec * sizeof(PackSection));
+  memcpy(out + at_recs, recs, nlines * sizeof(LineRec));
+  huff_store(out + at_huff);
+  memcpy(out + at_huff + HUFF_PACKED, dict, dn);
+  memcpy(out + at_huff + HUFF_PACKED + dn, fbuf, fbuf_len);
+  memcpy(out + at_data, data, data_n);
+  h.sum = pack_sum(out + sizeof(h), at_data - sizeof(h));
+  memcpy(out, &h, sizeof(h));
+  fb_reset();
+
+  snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+  mkdir_parents(path);
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  ok = fd >= 0 && write(fd, out, size) == (ssize_t)size;
+  if (fd >= 0)
+    close(fd);
+  if (!ok || rename(tmp, path) != 0) {
+    fprintf(stderr, "%s: %s: %s\n", tutor->name, path, strerror(errno));
+    unlink(tmp);
+    ok = 0;
+  } else {
+    printf("  %s: %d секций (%u сжато), %zu → %zu байт, словарь %zu\n", path,
+           nsec, nz, total, size, dn);
+  }
+done:
+  free(src);
+  free(dict);
+  free(sym);
+  free(data);
+  free(recs);
+  free(out);
+  return ok ? 0 : 1;
+}
+
+static int name_cmp(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int mtime_after(const struct stat *a, const struct stat *b) {
+  return a->st_mtim.tv_sec != b->st_mtim.tv_sec
+             ? a->st_mtim.tv_sec > b->st_mtim.tv_sec
+             : a->st_mtim.tv_nsec > b->st_mtim.tv_nsec;
+}
+
+/* use_pack = 0 — только .tut, для --pack */
+static void content_load(int use_pack) {
+  for (int i = 0; i < tutor->n; i++)
+    sections[i] = (Section){tutor->ids[i], tutor->labels[i],
+                            tutor->sections[i], NULL, NULL, 0, NULL, 0, 0,
+                            0, 0, 0};
+  nsections = tutor->n;
+  content_external = 0;
+  pack_huff = NULL;
+  pack_dict = NULL;
+  pack_dict_n = 0;
+
+  char dir[1024], pfile[1024];
+  if (tutor_path("XDG_DATA_HOME", ".local/share", "", dir,
+               sizeof(dir)) != 0 ||
+      tutor_path("XDG_DATA_HOME", ".local/share", ".pack", pfile,
+               sizeof(pfile)) != 0)
+    return;
+  struct stat pst, fst;
+  use_pack = use_pack && stat(pfile, &pst) == 0;
+
+  DIR *d = opendir(dir);
+  /* pack должен быть строго новее и каталога (удаления, переименования),
+     и каждого .tut: часы ФС грубее, чем интервал между правкой и --pack */
+  if (use_pack && d && fstat(dirfd(d), &fst) == 0 && !mtime_after(&pst, &fst))
+    use_pack = 0;
+  char *names[SECTIONS_MAX];
+  int nn = 0;
+  struct dirent *e;
+  while (d && (e = readdir(d)) && nn < SECTIONS_MAX) {
+    size_t len = strlen(e->d_name);
+    if (len > 4 && e->d_name[0] != '.' &&
+        !strcmp(e->d_name + len - 4, ".tut")) {
+      names[nn++] = strdup(e->d_name);
+      if (use_pack && fstatat(dirfd(d), e->d_name, &fst, 0) == 0 &&
+          !mtime_after(&pst, &fst))
+        use_pack = 0;
+    }
+  }
+
+  if (!use_pack || pack_load(pfile) != 0) {
+    qsort(names, (size_t)nn, sizeof(names[0]), name_cmp);
+    for (int i = 0; i < nn; i++) {
+      Section s;
+      if (names[i] && content_load_file(dirfd(d), names[i], &s) == 0)
+        section_put(&s);
+    }
+  }
+  for (int i = 0; i < nn; i++)
+    free(names[i]);
+  if (d)
+    closedir(d);
+}
+
+/* --init-content: встроенные секции → .tut-файлы для правки.
+   Существующие файлы не трогаем. */
+static int content_init(void) {
+  char dir[1024], path[1100];
+  if (tutor_path("XDG_DATA_HOME", ".local/share", "/", dir,
+               sizeof(dir)) != 0)
+    return 1;
+  mkdir_parents(dir);
+  for (int i = 0; i < tutor->n; i++) {
+    snprintf(path, sizeof(path), "%s%s.tut", dir, tutor->ids[i]);
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      if (errno != EEXIST) {
+        fprintf(stderr, "%s: %s: %s\n", tutor->name, path, strerror(errno));
+        return 1;
+      }
+      printf("  есть    %s\n", path);
+      continue;
+    }
+    fb_reset();
+    fb_appendf("# %s\nM:%s\n", tutor->ids[i], tutor->labels[i]);
+    for (int j = 0; tutor->sections[i][j]; j++) {
+      fb_append(tutor->sections[i][j]);
+      fb_append("\n");
+    }
+    size_t want = fbuf_len;
+    ssize_t w = write(fd, fbuf, want);
+    close(fd);
+    fb_reset();
+    if (w != (ssize_t)want) {
+      fprintf(stderr, "%s: %s: %s\n", tutor->name, path, strerror(errno));
+      return 1;
+    }
+    printf("  создан  %s\n", path);
+  }
+  return 0;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   RENDER CACHE
+   Готовый flat каждой секции (строки экрана + поисковый индекс) живёт
+   между запусками в $XDG_CACHE_HOME/tutor/<tutor>.render и mmap'ится
+   при старте. Ключ — тема, build-id (inode, размер, mtime бинаря) и
+   подписи секций (хэш .tut, сумма pack'а); не совпал — файл не
+   используется и при выходе пишется заново. Два tutor'а, стартующие
+   разом, пишут каждый свой tmp и делают rename: читатель видит либо
+   старый файл, либо новый целиком.
+   Ширины терминала в ключе нет: раскладка от неё не зависит.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define RENDER_MAGIC "TUTREND"
+#define RENDER_VERSION 1
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t nsec, nlines, heap_size;
+  uint64_t key;
+  uint64_t sum; /* pack_sum всего после заголовка */
+} RenderHeader;
+
+typedef struct {
+  uint32_t id; /* смещения — в heap */
+  uint32_t first, n;
+  uint32_t pad;
+} RenderSection;
+
+typedef struct {
+  uint32_t text, srch;
+  int32_t src;
+  uint32_t pad;
+} RenderLine;
+
+_Static_assert(sizeof(RenderHeader) == 40, "RenderHeader layout");
+_Static_assert(sizeof(RenderSection) == 16, "RenderSection layout");
+_Static_assert(sizeof(RenderLine) == 16, "RenderLine layout");
+
+static const unsigned char *render_map = NULL; /* образ кэша */
+static size_t render_size = 0;
+static int render_valid = 0;       /* render_map соответствует контенту */
+static int render_disk = 0;        /* …и файл кэша тоже */
+static void *render_base = NULL;   /* отображение: файл, shm или anon */
+static size_t render_base_size = 0;
+
+static uint64_t render_key(void) {
+  static struct stat exe;
+  static int have_exe = -1;
+  if (have_exe < 0)
+    have_exe = stat("/proc/self/exe", &exe) == 0;
+  uint64_t sig = 0;
+  for (int i = 0; i < nsections; i++)
+    sig = (sig ^ key_hash(sections[i].id, strlen(sections[i].id), 0) ^
+           sections[i].sig) * 0x100000001b3ull;
+  char id[512];
+  int n = snprintf(id, sizeof(id),
+                   "%s%s%s%s%s%s%s%s|%s:%d|%lu:%lld:%lld.%ld|%llx", tutor->title,
+                   C_KEY, C_DESC, C_HEAD, C_SEP, C_HINT, C_CUR, C_CODE,
+                   tutor->name, tutor->key_w,
+                   have_exe ? (unsigned long)exe.st_ino : 0,
+                   have_exe ? (long long)exe.st_size : 0,
+                   have_exe ? (long long)exe.st_mtim.tv_sec : 0,
+                   have_exe ? exe.st_mtim.tv_nsec : 0, (unsigned long long)sig);
+  return (uint64_t)key_hash(id, (size_t)n, 1) << 32 |
+         key_hash(id, (size_t)n, 2);
+}
+
+/* образ кэша проверен целиком: заголовок, ключ, сумма, все смещения */
+static int render_check(const unsigned char *map, size_t size) {
+  const RenderHeader *h = (const RenderHeader *)map;
+  if (size < sizeof(*h))
+    return 0;
+  size_t at_lines = sizeof(*h) + (size_t)h->nsec * sizeof(RenderSection);
+  size_t at_heap = at_lines + (size_t)h->nlines * sizeof(RenderLine);
+  if (memcmp(h->magic, RENDER_MAGIC, 8) || h->version != RENDER_VERSION ||
+      h->key != render_key() || h->nsec > SECTIONS_MAX ||
+      h->nlines > size || h->heap_size == 0 ||
+      at_heap + h->heap_size != size ||
+      pack_sum(map + sizeof(*h), size - sizeof(*h)) != h->sum)
+    return 0;
+  const RenderSection *rs = (const RenderSection *)(map + sizeof(*h));
+  const RenderLine *rl = (const RenderLine *)(map + at_lines);
+  const char *heap = (const char *)map + at_heap;
+  /* все строки кончаются '\0' внутри heap, раз последний байт — '\0' */
+  if (heap[h->heap_size - 1] != '\0')
+    return 0;
+  for (uint32_t i = 0; i < h->nsec; i++)
+    if (rs[i].id >= h->heap_size || rs[i].first > h->nlines ||
+        rs[i].n > h->nlines - rs[i].first)
+      return 0;
+  for (uint32_t i = 0; i < h->nlines; i++)
+    if (rl[i].text >= h->heap_size || rl[i].srch >= h->heap_size)
+      return 0;
+  return 1;
+}
+
+/* секция в действующем кэше; NULL — кэша нет или её там нет */
+static const RenderSection *render_section(int sec_idx) {
+  const RenderHeader *h = (const RenderHeader *)render_map;
+  if (!render_valid || sec_idx < 0)
+    return NULL;
+  const RenderSection *rs = (const RenderSection *)(h + 1);
+  const char *heap = (const char *)((const RenderLine *)(rs + h->nsec) +
+                                    h->nlines);
+  for (uint32_t s = 0; s < h->nsec; s++)
+    if (!strcmp(heap + rs[s].id, sections[sec_idx].id))
+      return &rs[s];
+  return NULL;
+}
+
+/* строки экрана секции в f: из кэша, если он в силе, иначе готовые
+   от SPECULATIVE FLATTEN, иначе tv_flat_build */
+static void flat_open(TvFlat *f, const char **sec, int sec_idx) {
+  const RenderSection *r = render_section(sec_idx);
+  if (!r) {
+    if (!spec_take(f, sec))
+      tv_flat_build(f, tutor, sec);
+    return;
+  }
+  const RenderHeader *h = (const RenderHeader *)render_map;
+  const RenderLine *rl =
+      (const RenderLine *)((const RenderSection *)(h + 1) + h->nsec);
+  char *heap = (char *)(rl + h->nlines);
+  tv_flat_free(f);
+  for (uint32_t i = r->first; i < r->first + r->n; i++)
+    tv_flat_push(f, (TvLine){heap + rl[i].text, heap + rl[i].srch, rl[i].src,
+                             1});
+}
+
+static size_t render_str(char **heap, size_t *len, size_t *cap, const char *s) {
+  size_t n = strlen(s) + 1, at = *len;
+  if (*len + n > *cap) {
+    size_t nc = *cap ? *cap * 2 : 65536;
+    while (nc < *len + n)
+      nc *= 2;
+    char *tmp = realloc(*heap, nc);
+    if (!tmp)
+      return 0;
+    *heap = tmp;
+    *cap = nc;
+  }
+  memcpy(*heap + at, s, n);
+  *len += n;
+  return at;
+}
+
+/* flat всех секций → образ файла кэша (malloc), NULL — не вышло */
+static unsigned char *render_image(size_t *size) {
+  RenderSection rs[SECTIONS_MAX];
+  RenderLine *rl = NULL;
+  size_t nl = 0, lcap = 0, hlen = 0, hcap = 0;
+  char *heap = NULL;
+  unsigned char *buf = NULL;
+  TvFlat f = {0};
+  render_str(&heap, &hlen, &hcap, ""); /* смещение 0 — пустая строка */
+  for (int s = 0; s < nsections; s++) {
+    flat_open(&f, sec_lines(s), -1);
+    rs[s] = (RenderSection){(uint32_t)render_str(&heap, &hlen, &hcap,
+                                                 sections[s].id),
+                            (uint32_t)nl, (uint32_t)f.n, 0};
+    for (int i = 0; i < f.n; i++) {
+      if (nl == lcap) {
+        lcap = lcap ? lcap * 2 : 1024;
+        RenderLine *t = realloc(rl, lcap * sizeof(RenderLine));
+        if (!t)
+          goto out;
+        rl = t;
+      }
+      rl[nl++] = (RenderLine){
+          (uint32_t)render_str(&heap, &hlen, &hcap, f.v[i].text),
+          (uint32_t)render_str(&heap, &hlen, &hcap, tv_flat_srch(&f, i)),
+          f.v[i].src, 0};
+    }
+  }
+  if (!heap || hlen >= UINT32_MAX)
+    goto out;
+
+  size_t body = (size_t)nsections * sizeof(RenderSection) +
+                nl * sizeof(RenderLine) + hlen;
+  if (!(buf = malloc(sizeof(RenderHeader) + body)))
+    goto out;
+  RenderHeader *h = (RenderHeader *)buf;
+  memset(h, 0, sizeof(*h));
+  memcpy(h->magic, RENDER_MAGIC, 8);
+  h->version = RENDER_VERSION;
+  h->nsec = (uint32_t)nsections;
+  h->nlines = (uint32_t)nl;
+  h->heap_size = (uint32_t)hlen;
+  h->key = render_key();
+  unsigned char *p = buf + sizeof(*h);
+  memcpy(p, rs, (size_t)nsections * sizeof(RenderSection));
+  p += (size_t)nsections * sizeof(RenderSection);
+  memcpy(p, rl, nl * sizeof(RenderLine));
+  p += nl * sizeof(RenderLine);
+  memcpy(p, heap, hlen);
+  h->sum = pack_sum(buf + sizeof(*h), body);
+  *size = sizeof(*h) + body;
+out:
+  tv_flat_release(&f);
+  free(rl);
+  free(heap);
+  return buf;
+}
+
+/* ── общая память ───────────────────────────────────────────────────
+   Образ кэша публикуется в POSIX shm /tutor-<uid>-<tutor>-<ключ>: пока
+   файл не записан (первый запуск, правка контента), соседние tutor'ы
+   берут готовое оттуда. Сегмент пишется один раз — ключ в имени, —
+   под seqlock: seq нечётный, пока пишут, чётный после. Читатель не
+   ждёт никогда: нечётный seq — строит сам; seq сверяется до и после
+   проверки образа. Если писатель умер на полпути, сегмент удаляет
+   первый заметивший это читатель. */
+
+typedef struct {
+  atomic_uint seq;
+  int32_t pid;   /* писатель */
+  uint64_t size; /* образ после заголовка */
+} ShmHeader;
+
+_Static_assert(sizeof(ShmHeader) == 16, "образ выровнен на 8");
+
+static void shm_name(uint64_t key, char *out, size_t cap) {
+  snprintf(out, cap, "/tutor-%u-%s-%016llx", (unsigned)getuid(), tutor->name,
+           (unsigned long long)key);
+}
+
+static int shm_attach(uint64_t key) {
+  char name[128];
+  shm_name(key, name, sizeof(name));
+  int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0)
+    return 0;
+  struct stat st;
+  void *map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > (off_t)sizeof(ShmHeader) &&
+      st.st_size <= CONTENT_MAX * 4)
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return 0;
+  ShmHeader *h = map;
+  size_t size = (size_t)st.st_size;
+  unsigned seq = atomic_load_explicit(&h->seq, memory_order_acquire);
+  int ok = seq && !(seq & 1) && h->size <= size - sizeof(*h) &&
+           render_check((unsigned char *)(h + 1), (size_t)h->size);
+  atomic_thread_fence(memory_order_acquire);
+  ok = ok && atomic_load_explicit(&h->seq, memory_order_relaxed) == seq;
+  if (!ok && (seq & 1) && kill(h->pid, 0) != 0 && errno == ESRCH)
+    shm_unlink(name); /* писатель умер, не дописав */
+  if (!ok) {
+    munmap(map, size);
+    return 0;
+  }
+  render_base = map;
+  render_base_size = size;
+  render_map = (const unsigned char *)(h + 1);
+  render_size = (size_t)h->size;
+  render_valid = 1;
+  return 1;
+}
+
+/* сегменты этой шпаргалки со старыми ключами; у кого они отображены,
+   те доживут до munmap */
+static void shm_sweep(const char *keep) {
+  char prefix[96];
+  int n = snprintf(prefix, sizeof(prefix), "tutor-%u-%s-", (unsigned)getuid(),
+                   tutor->name);
+  DIR *d = opendir("/dev/shm");
+  struct dirent *e;
+  while (d && (e = readdir(d)))
+    if (!strncmp(e->d_name, prefix, (size_t)n) &&
+        strlen(e->d_name) == (size_t)n + 16 && strcmp(e->d_name, keep + 1)) {
+      char name[300];
+      snprintf(name, sizeof(name), "/%s", e->d_name);
+      shm_unlink(name);
+    }
+  if (d)
+    closedir(d);
+}
+
+static int shm_publish(uint64_t key, const unsigned char *img, size_t size) {
+  char name[128];
+  shm_name(key, name, sizeof(name));
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0)
+    return 0;
+  size_t total = sizeof(ShmHeader) + size;
+  void *map = MAP_FAILED;
+  if (ftruncate(fd, (off_t)total) == 0)
+    map = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    shm_unlink(name);
+    return 0;
+  }
+  ShmHeader *h = map;
+  h->pid = (int32_t)getpid();
+  atomic_store_explicit(&h->seq, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  memcpy(h + 1, img, size);
+  h->size = size;
+  atomic_store_explicit(&h->seq, 2, memory_order_release);
+  shm_sweep(name);
+
+  render_base = map;
+  render_base_size = total;
+  render_map = (const unsigned char *)(h + 1);
+  render_size = size;
+  render_valid = 1;
+  return 1;
+}
+
+static void render_unmap(void) {
+  if (render_base)
+    munmap(render_base, render_base_size);
+  render_base = NULL;
+  render_map = NULL;
+  render_valid = render_disk = 0;
+}
+
+/* готовый кэш: файл, иначе сегмент соседа; сам ничего не строит */
+static int render_attach(void) {
+  render_unmap();
+  char path[1024];
+  int fd = -1;
+  if (tutor_path("XDG_CACHE_HOME", ".cache", ".render", path,
+                 sizeof(path)) == 0)
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 &&
+      st.st_size >= (off_t)sizeof(RenderHeader) &&
+      st.st_size <= CONTENT_MAX * 4) {
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      render_base = map;
+      render_base_size = render_size = (size_t)st.st_size;
+      render_map = map;
+      render_valid = render_disk = render_check(map, render_size);
+    }
+  }
+  if (fd >= 0)
+    close(fd);
+  if (render_valid)
+    return 1;
+  render_unmap();
+  return shm_attach(render_key());
+}
+
+/* кэш текущей шпаргалки: файл, иначе сегмент соседа, иначе строим сами
+   и публикуем. Не вышло и это — flat_open строит секции по одной */
+static void render_load(void) {
+  if (render_attach())
+    return;
+  uint64_t key = render_key();
+  size_t size;
+  unsigned char *img = render_image(&size);
+  if (img && !shm_publish(key, img, size)) {
+    /* сегмент занят пишущим соседом: ждать его не будем */
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map != MAP_FAILED) {
+      memcpy(map, img, size);
+      render_base = map;
+      render_base_size = render_size = size;
+      render_map = map;
+      render_valid = 1;
+    }
+  }
+  free(img);
+}
+
+/* выход, Tab: файл кэша — для следующего холодного старта */
+static void render_save(void) {
+  if (render_disk)
+    return;
+  char path[1024], tmp[1100];
+  if (tutor_path("XDG_CACHE_HOME", ".cache", ".render", path,
+                 sizeof(path)) != 0)
+    return;
+  size_t size = render_size;
+  unsigned char *img = render_valid ? NULL : render_image(&size);
+  const unsigned char *src = render_valid ? render_map : img;
+  if (!src)
+    return;
+  snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+  mkdir_parents(tmp);
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd >= 0) {
+    int ok = write(fd, src, size) == (ssize_t)size;
+    close(fd);
+    if (!ok || rename(tmp, path) != 0)
+      unlink(tmp);
+    else
+      render_disk = render_valid;
+  }
+  free(img);
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   HOT RELOAD
+   inotify на каталог .tut-файлов и на tutor/, где лежит pack.
+   read_key_raw ждёт клавиатуру и inotify вместе и на событие отдаёт
+   KEY_RELOAD; content_reload разбирает очередь и перечитывает только
+   изменившиеся .tut. Новый pack (или переполнение очереди) — полная
+   перезагрузка. Старые буферы не освобождаются: на них ещё смотрят
+   «Недавние», а правки во время одной сессии — это килобайты.
+   ══════════════════════════════════════════════════════════════════════ */
+
+static int watch_dir = -1; /* wd каталога <tutor>/ */
+static int watch_top = -1; /* wd tutor/ — pack и появление каталога */
+
+#define WATCH_DIR_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)
+
+static void content_watch(void) {
+  char dir[1024];
+  if (tutor_path("XDG_DATA_HOME", ".local/share", "", dir,
+               sizeof(dir)) != 0 ||
+      (watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0)
+    return;
+  watch_dir = inotify_add_watch(watch_fd, dir, WATCH_DIR_MASK | IN_ONLYDIR);
+  *strrchr(dir, '/') = '\0';
+  watch_top = inotify_add_watch(watch_fd, dir,
+                                WATCH_DIR_MASK | IN_CREATE | IN_ONLYDIR);
+  if (watch_dir < 0 && watch_top < 0) {
+    close(watch_fd);
+    watch_fd = -1;
+  }
+}
+
+static void content_unwatch(void) {
+  if (watch_fd >= 0)
+    close(watch_fd);
+  watch_fd = watch_dir = watch_top = -1;
+}
+
+/* файл секции удалён: встроенная возвращается, добавленная исчезает */
+static void content_drop(const char *id) {
+  int j = 0;
+  while (j < nsections && strcmp(sections[j].id, id))
+    j++;
+  if (j == nsections)
+    return;
+  if (j < tutor->n) {
+    sections[j] = (Section){tutor->ids[j], tutor->labels[j],
+                            tutor->sections[j], NULL, NULL, 0, NULL, 0, 0,
+                            0, 0, 0};
+    return;
+  }
+  memmove(&sections[j], &sections[j + 1],
+          (size_t)(nsections - j - 1) * sizeof(Section));
+  nsections--;
+}
+
+/* → 1, если что-то перечитано */
+static int content_reload(void) {
+  char ev[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  char names[SECTIONS_MAX][256];
+  int nn = 0, full = 0;
+  size_t nl = strlen(tutor->name);
+  ssize_t n;
+
+  spec_quiesce();
+  while ((n = read(watch_fd, ev, sizeof(ev))) > 0) {
+    const struct inotify_event *e;
+    for (char *p = ev; p < ev + n; p += sizeof(*e) + e->len) {
+      e = (const struct inotify_event *)p;
+      size_t len = e->len ? strlen(e->name) : 0;
+      if (e->mask & IN_Q_OVERFLOW) {
+        full = 1;
+      } else if (e->wd == watch_top && len) {
+        if (!strncmp(e->name, tutor->name, nl) &&
+            !strcmp(e->name + nl, ".pack"))
+          full = 1;
+        if (!strcmp(e->name, tutor->name) && (e->mask & IN_ISDIR) &&
+            (e->mask & (IN_CREATE | IN_MOVED_TO))) {
+          char dir[1024];
+          if (tutor_path("XDG_DATA_HOME", ".local/share", "", dir,
+                       sizeof(dir)) == 0)
+            watch_dir = inotify_add_watch(watch_fd, dir,
+                                          WATCH_DIR_MASK | IN_ONLYDIR);
+          full = 1;
+        }
+      } else if (e->wd == watch_dir && len > 4 && len < 256 &&
+                 e->name[0] != '.' && !strcmp(e->name + len - 4, ".tut")) {
+        int k = 0;
+        while (k < nn && strcmp(names[k], e->name))
+          k++;
+        if (k == nn && nn < SECTIONS_MAX)
+          memcpy(names[nn++], e->name, len + 1);
+      }
+    }
+  }
+
+  if (full || nn)
+    render_valid = render_disk = 0; /* подписи секций поменялись */
+  if (full) {
+    content_load(1);
+    return 1;
+  }
+  char dir[1024];
+  int dfd = -1;
+  if (nn && tutor_path("XDG_DATA_HOME", ".local/share", "", dir,
+                     sizeof(dir)) == 0)
+    dfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  for (int i = 0; i < nn; i++) {
+    Section s;
+    if (dfd >= 0 && content_load_file(dfd, names[i], &s) == 0) {
+      section_put(&s);
+    } else {
+      names[i][strlen(names[i]) - 4] = '\0';
+      content_drop(names[i]);
+    }
+  }
+  if (dfd >= 0)
+    close(dfd);
+  return nn > 0;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   DETAIL PAGES
+   Enter на R:-строке открывает подробности по её ключу: man-страницу,
+   `--help`, `:help` — как скажет tutor->detail. Вывод читается из
+   неблокирующей трубы и дорисовывается по мере поступления (KEY_TICK).
+   Готовая страница ложится в $XDG_CACHE_HOME/tutor/<tutor>/<hash>.txt;
+   версия инструмента — inode, размер и mtime его бинаря — входит в
+   hash, так что повторное открытие — одно чтение файла без fork, а
+   после обновления инструмента страница строится заново.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define DETAIL_MAX (4 << 20) /* больше — обрезаем */
+
+static const char **detail_lines = NULL; /* "T:ключ", "P:строка"…, NULL */
+static int detail_n = 0, detail_cap = 0;
+static int detail_fd = -1; /* труба от процесса, -1 — страница целиком */
+static pid_t detail_pid = -1;
+static char *detail_buf = NULL; /* сырой вывод; до detail_done — разобран */
+static size_t detail_len = 0, detail_bcap = 0, detail_done = 0;
+static char detail_cache[1100];
+
+static void detail_push(char *line) {
+  if (!line)
+    return;
+  if (detail_n + 2 > detail_cap) {
+    int nc = detail_cap ? detail_cap * 2 : 256;
+    const char **tmp = realloc(detail_lines, (size_t)nc * sizeof(char *));
+    if (!tmp) {
+      free(line);
+      return;
+    }
+    detail_lines = tmp;
+    detail_cap = nc;
+  }
+  detail_lines[detail_n++] = line;
+  detail_lines[detail_n] = NULL;
+}
+
+/* строка вывода без SGR и забоя (man: "_\bx", "x\bx") → "P:…" */
+static void detail_line(const char *s, size_t n) {
+  char line[1024];
+  if (n > sizeof(line) - 3)
+    n = sizeof(line) - 3;
+  memcpy(line + 2, s, n);
+  n = tv_ansi_strip(line + 2, n, line + 2);
+  size_t o = 2;
+  for (size_t i = 2; i < n + 2; i++) {
+    if (i + 1 < n + 2 && line[i + 1] == '\b')
+      i++;
+    else if (line[i] != '\b' && line[i] != '\r')
+      line[o++] = line[i];
+  }
+  memcpy(line, "P:", 2);
+  line[o] = '\0';
+  detail_push(strdup(line));
+}
+
+/* новые байты: целые строки — в страницу, хвост ждёт '\n' */
+static void detail_feed(const char *s, size_t n) {
+  if (detail_len + n > DETAIL_MAX)
+    n = DETAIL_MAX - detail_len;
+  if (detail_len + n > detail_bcap) {
+    size_t nc = detail_bcap ? detail_bcap : 16384;
+    while (nc < detail_len + n)
+      nc *= 2;
+    char *tmp = realloc(detail_buf, nc);
+    if (!tmp)
+      return;
+    detail_buf = tmp;
+    detail_bcap = nc;
+  }
+  memcpy(detail_buf + detail_len, s, n);
+  detail_len += n;
+  char *nl;
+  while ((nl = memchr(detail_buf + detail_done, '\n',
+                      detail_len - detail_done))) {
+    detail_line(detail_buf + detail_done,
+                (size_t)(nl - detail_buf) - detail_done);
+    detail_done = (size_t)(nl - detail_buf) + 1;
+  }
+}
+
+/* труба кончилась: хвост, код выхода, кэш */
+static void detail_finish(void) {
+  if (detail_done < detail_len) {
+    detail_line(detail_buf + detail_done, detail_len - detail_done);
+    detail_done = detail_len;
+  }
+  int st = 0;
+  close(detail_fd);
+  detail_fd = tick_fd = -1;
+  waitpid(detail_pid, &st, 0);
+  detail_pid = -1;
+  if (detail_n > 1 && WIFEXITED(st) && WEXITSTATUS(st) == 0) {
+    char tmp[1200];
+    snprintf(tmp, sizeof(tmp), "%s.%d", detail_cache, (int)getpid());
+    mkdir_parents(tmp);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+      /* строки уже очищены — в кэш идёт то, что видно на экране */
+      int ok = 1;
+      for (int i = 1; i < detail_n && ok; i++) {
+        size_t n = strlen(detail_lines[i] + 2);
+        ok = write(fd, detail_lines[i] + 2, n) == (ssize_t)n &&
+             write(fd, "\n", 1) == 1;
+      }
+      close(fd);
+      if (!ok || rename(tmp, detail_cache) != 0)
+        unlink(tmp);
+    }
+  }
+  if (detail_n == 1)
+    detail_line("нет подробностей", strlen("нет подробностей"));
+}
+
+/* KEY_TICK: дочитать, что есть; → первая новая строка, 0 — страница
+   готова, перестроить целиком, -1 — ничего не изменилось */
+static int detail_pump(void) {
+  if (detail_fd < 0)
+    return -1;
+  char buf[16384];
+  int before = detail_n;
+  ssize_t n;
+  while ((n = read(detail_fd, buf, sizeof(buf))) > 0)
+    detail_feed(buf, (size_t)n);
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+    detail_finish();
+    return 0;
+  }
+  return detail_n != before ? before : -1;
+}
+
+/* бинарь name из $PATH */
+static int detail_which(const char *name, struct stat *st) {
+  const char *path = getenv("PATH");
+  char buf[1024];
+  if (!path || strchr(name, '/'))
+    return -1;
+  for (const char *p = path; *p;) {
+    size_t n = strcspn(p, ":");
+    snprintf(buf, sizeof(buf), "%.*s/%s", (int)n, p, name);
+    if (access(buf, X_OK) == 0 && stat(buf, st) == 0 && S_ISREG(st->st_mode))
+      return 0;
+    p += n + (p[n] == ':');
+  }
+  return -1;
+}
+
+static void detail_close(void) {
+  if (detail_fd >= 0) {
+    kill(detail_pid, SIGTERM);
+    close(detail_fd);
+    waitpid(detail_pid, NULL, 0);
+    detail_fd = tick_fd = -1;
+  }
+  for (int i = 0; i < detail_n; i++)
+    free((char *)detail_lines[i]);
+  detail_n = 0;
+  detail_len = detail_done = 0;
+}
+
+/* R:-строка → страница в detail_lines (из кэша или из процесса, который
+   дальше читает detail_pump); → 0, если подробностей не бывает */
+static int detail_open(const char *row) {
+  char key[256], tool[64];
+  const char *content = row + 2;
+  size_t kn = strcspn(content, "|");
+  if (row[0] != 'R' || !tutor->detail || kn == 0 || kn >= sizeof(key))
+    return 0;
+  memcpy(key, content, kn);
+  key[kn] = '\0';
+  snprintf(tool, sizeof(tool), "%.*s", (int)strcspn(key, " "), key);
+  struct stat st;
+  if (detail_which(tutor->detail_tool ? tutor->detail_tool : tool, &st) != 0)
+    return 0;
+
+  char id[512], name[64];
+  int idn = snprintf(id, sizeof(id), "%s\n%s\n%lu:%lld:%lld.%ld", tutor->name,
+                     key, (unsigned long)st.st_ino, (long long)st.st_size,
+                     (long long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+  snprintf(name, sizeof(name), "/%08x%08x.txt",
+           key_hash(id, (size_t)idn, 1), key_hash(id, (size_t)idn, 2));
+  char dir[1024];
+  if (tutor_path("XDG_CACHE_HOME", ".cache", "", dir, sizeof(dir)) != 0)
+    return 0;
+  snprintf(detail_cache, sizeof(detail_cache), "%s%s", dir, name);
+
+  detail_close();
+  char title[300];
+  snprintf(title, sizeof(title), "T:%s", key);
+  detail_push(strdup(title));
+
+  int fd = open(detail_cache, O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    char buf[16384];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+      detail_feed(buf, (size_t)n);
+    close(fd);
+    return 1;
+  }
+
+  int p[2];
+  if (pipe2(p, O_CLOEXEC) != 0)
+    return 0;
+  fflush(NULL);
+  detail_pid = fork();
+  if (detail_pid == 0) {
+    int null = open("/dev/null", O_RDWR);
+    dup2(null, STDIN_FILENO);
+    dup2(p[1], STDOUT_FILENO);
+    dup2(null, STDERR_FILENO);
+    setenv("MANWIDTH", "80", 1);
+    setenv("MANPAGER", "cat", 1);
+    setenv("PAGER", "cat", 1);
+    setenv("GIT_PAGER", "cat", 1);
+    execl("/bin/sh", "sh", "-c", tutor->detail, "sh", key, (char *)NULL);
+    _exit(127);
+  }
+  close(p[1]);
+  if (detail_pid < 0) {
+    close(p[0]);
+    return 0;
+  }
+  fcntl(p[0], F_SETFL, O_NONBLOCK);
+  detail_fd = tick_fd = p[0];
+  return 1;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   SESSION
+   $XDG_STATE_HOME/tutor/<tutor>.state — где остановились: пункт меню,
+   открытая секция и cursor/offset каждой секции. Файл фиксированного
+   размера mmap'ится MAP_SHARED и правится на месте обычной записью в
+   память: ни сериализации, ни fsync — на диск его сбрасывает ядро.
+   Секции узнаём по хэшу id, так что новая секция ничего не сдвигает.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define STATE_MAGIC "TUTSTAT"
+#define STATE_VERSION 1
+#define STATE_SLOTS 64 /* открытая адресация, степень двойки */
+
+typedef struct {
+  uint32_t id; /* key_hash id секции, 0 — пусто */
+  int32_t cursor, offset;
+  uint32_t pad;
+} StateSlot;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t menu; /* id пункта под курсором меню */
+  uint32_t open; /* id открытой секции, 0 — были в меню */
+  uint32_t pad;
+  StateSlot slot[STATE_SLOTS];
+} State;
+
+_Static_assert(sizeof(State) == 24 + 16 * STATE_SLOTS, "State layout");
+
+static State state_mem; /* если файла нет — живём в памяти */
+static State *state = &state_mem;
+
+static uint32_t state_id(int sec_idx) {
+  if (sec_idx == SEC_RECENT)
+    return 1; /* у секций id ≥ 2 */
+  if (sec_idx < 0 || sec_idx >= nsections)
+    return 0;
+  uint32_t h = key_hash(sections[sec_idx].id, strlen(sections[sec_idx].id), 3);
+  return h > 1 ? h : 2;
+}
+
+static void state_open(void) {
+  char path[1024];
+  if (tutor_path("XDG_STATE_HOME", ".local/state", ".state", path,
+                 sizeof(path)) != 0)
+    return;
+  int fd = open(path, O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    mkdir_parents(path);
+    fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  }
+  if (fd < 0)
+    return;
+  struct stat st;
+  State *map = MAP_FAILED;
+  /* ftruncate растит файл нулями: пустой — тот же «нет состояния» */
+  if (fstat(fd, &st) == 0 &&
+      (st.st_size == (off_t)sizeof(State) ||
+       ftruncate(fd, (off_t)sizeof(State)) == 0))
+    map = mmap(NULL, sizeof(State), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return;
+  if (memcmp(map->magic, STATE_MAGIC, 8) || map->version != STATE_VERSION) {
+    memset(map, 0, sizeof(State));
+    memcpy(map->magic, STATE_MAGIC, 8);
+    map->version = STATE_VERSION;
+  }
+  state = map;
+}
+
+static void state_close(void) {
+  if (state != &state_mem)
+    munmap(state, sizeof(State));
+  memset(&state_mem, 0, sizeof(state_mem));
+  state = &state_mem;
+}
+
+/* слот секции; create — занять свободный (или вытеснить домашний) */
+static StateSlot *state_slot(int sec_idx, int create) {
+  uint32_t id = state_id(sec_idx);
+  if (!id)
+    return NULL;
+  size_t home = id & (STATE_SLOTS - 1);
+  for (size_t p = 0; p < STATE_SLOTS; p++) {
+    StateSlot *s = &state->slot[(home + p) & (STATE_SLOTS - 1)];
+    if (s->id == id)
+      return s;
+    if (!s->id) {
+      if (!create)
+        return NULL;
+      *s = (StateSlot){id, 0, 0, 0};
+      return s;
+    }
+  }
+  if (!create)
+    return NULL;
+  state->slot[home] = (StateSlot){id, 0, 0, 0};
+  return &state->slot[home];
+}
+
+/* id → индекс секции (или SEC_RECENT); -3 — такой больше нет */
+static int state_sec(uint32_t id) {
+  if (id == 1)
+    return SEC_RECENT;
+  for (int i = 0; id && i < nsections; i++)
+    if (state_id(i) == id)
+      return i;
+  return -3;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   SECTION VIEWER
+   ══════════════════════════════════════════════════════════════════════ */
+
+/* та же строка после правки: R: — по ключу, остальные — по тексту */
+static int line_same(const char *a, const char *b) {
+  if (a[0] != b[0])
+    return 0;
+  if (a[0] != 'R')
+    return !strcmp(a, b);
+  size_t n = strcspn(a, "|");
+  return n == strcspn(b, "|") && !memcmp(a, b, n);
+}
+
+/* кадры TutorView — в общий fbuf, наружу их выводит fb_present */
+static void view_sink(void *user, const char *buf, size_t n) {
+  (void)user;
+  fb_appendn(buf, n);
+}
+
+/* KEY_RELOAD в view_section. flat строится заново, только если открытая
+   секция действительно изменилась; курсор остаётся на той же строке.
+   → 0, если открытой секции больше нет */
+static int view_reload(TutorView *v, const char ***sec, int *sec_idx) {
+  const char *id = *sec_idx >= 0 ? sections[*sec_idx].id : NULL;
+  if (!content_reload() || *sec_idx < 0)
+    return 1; /* у «Недавних» и подробностей свои указатели, они в силе */
+
+  int s = 0;
+  while (s < nsections && strcmp(sections[s].id, id))
+    s++;
+  if (s == nsections)
+    return 0;
+  const char **old = *sec, **now = sec_lines(s);
+  int i = 0;
+  while (old[i] && now[i] && !strcmp(old[i], now[i]))
+    i++;
+  *sec_idx = s;
+  *sec = now;
+  if (!old[i] && !now[i])
+    return 1;
+
+  TvFlat *f = &v->flat;
+  int cur = v->cursor;
+  int src = f->n > 0 ? f->v[cur].src : -1, delta = 0;
+  while (src >= 0 && cur - delta > 0 && f->v[cur - delta - 1].src == src)
+    delta++; /* T: и G: занимают несколько строк экрана */
+  tv_flat_build(f, tutor, now);
+  int at = 0;
+  if (src >= 0)
+    while (at < f->n && !line_same(old[src], now[f->v[at].src]))
+      at++;
+  v->cursor = at < f->n ? at + delta : cur;
+  return 1;
+}
+
+static void view_section(const char **sec, int sec_idx) {
+  TutorView v;
+  tv_init(&v, tutor, view_sink, NULL);
+  flat_open(&v.flat, sec, sec_idx);
+
+  /* подробности не запоминаем: их держит родительская секция */
+  StateSlot *st = sec_idx != SEC_DETAIL ? state_slot(sec_idx, 1) : NULL;
+  if (st) {
+    v.cursor = st->cursor;
+    v.offset = st->offset;
+    state->open = st->id;
+  }
+  int dwelt = -1; /* строка, задержка на которой уже записана */
+
+  fb_append(CUR_HIDE);
+  fb_flush();
+
+  while (1) {
+    v.rows = term_rows();
+    v.cols = term_cols();
+    fb_reset();
+    tv_draw(&v);
+    fb_present();
+    if (st) {
+      st->cursor = v.cursor;
+      st->offset = v.offset;
+    }
+
+    long t0 = now_ms();
+    int key = read_key_raw();
+    if (key == KEY_TICK) {
+      /* по тику — только новые строки: длинный man не квадратичен */
+      int from = detail_pump();
+      if (from == 0)
+        tv_flat_build(&v.flat, tutor, sec = detail_lines);
+      else if (from > 0)
+        tv_flat_append(&v.flat, tutor, sec = detail_lines, from);
+      continue;
+    }
+    if (key == KEY_RELOAD) {
+      if (!view_reload(&v, &sec, &sec_idx))
+        break;
+      dwelt = -1;
+      continue;
+    }
+
+    int src = v.flat.n > 0 ? v.flat.v[v.cursor].src : -1;
+    if (!v.searching && src >= 0 && v.cursor != dwelt &&
+        now_ms() - t0 >= HIST_DWELL_MS) {
+      view_event(HIST_DWELL, sec, sec_idx, src);
+      dwelt = v.cursor;
+    }
+
+    int r = tv_key(&v, key);
+    if (r == TV_CLOSE)
+      break;
+    if (r == TV_ENTER) {
+      if (src >= 0)
+        view_event(HIST_SELECT, sec, sec_idx, src);
+      if (src >= 0 && sec_idx != SEC_DETAIL && detail_open(sec[src])) {
+        view_section(detail_lines, SEC_DETAIL);
+        detail_close();
+        flat_open(&v.flat, sec, sec_idx);
+      }
+    }
+  }
+
+  if (st)
+    state->open = 0;
+  tv_free(&v);
+  fb_append(CUR_SHOW);
+  fb_flush();
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   LARGE DOCUMENT
+   -f файл: произвольный текст любого размера (дамп `git help -a`, лог
+   истории zsh) в том же просмотрщике. Файл mmap'ится как есть, индекс
+   начал строк строят потоки: файл режется на куски по DOC_CHUNK, каждый
+   поток берёт следующий кусок и ищет '\n' по 16 байт за раз. Куски
+   разбираются по порядку, так что первый экран готов почти сразу, а
+   счётчик строк растёт, пока индексируется остальное.
+   Потоки не выходят: проиндексировав своё, они ждут поиска (DOC SEARCH).
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define DOC_CHUNK (1 << 20) /* байт на задачу индексатора */
+
+typedef struct {
+  uint32_t *start; /* начала строк, от начала куска */
+  size_t n, cap;
+  atomic_int done;
+} DocChunk;
+
+static const char *doc_map = NULL;
+static size_t doc_size = 0;
+static DocChunk *doc_chunk = NULL;
+static size_t doc_nchunk = 0;
+static atomic_size_t doc_next;   /* следующий кусок для потока */
+static atomic_int doc_stop;
+static size_t *doc_first = NULL; /* номер первой строки куска, nchunk + 1 */
+static size_t doc_ready = 0;     /* куски 0..ready-1 готовы подряд */
+static size_t doc_counted = 0;   /* строк во всех готовых кусках */
+static pthread_t *doc_th = NULL; /* по потоку на ядро */
+static int doc_nth = 0;
+
+static void doc_push(DocChunk *c, size_t rel) {
+  if (c->n == c->cap) {
+    size_t nc = c->cap ? c->cap * 2 : 1024;
+    uint32_t *tmp = realloc(c->start, nc * sizeof(uint32_t));
+    if (!tmp)
+      return;
+    c->start = tmp;
+    c->cap = nc;
+  }
+  c->start[c->n++] = (uint32_t)rel;
+}
+
+/* строка начинается после каждого '\n', кроме последнего байта файла */
+static void doc_scan(DocChunk *c, size_t lo, size_t hi) {
+  const char *p = doc_map;
+  size_t end = hi < doc_size ? hi : doc_size - 1;
+  size_t i = lo;
+  if (lo == 0)
+    doc_push(c, 0);
+#ifdef __SSE2__
+  const __m128i nl = _mm_set1_epi8('\n');
+  for (; i + 16 <= end; i += 16) {
+    unsigned m = (unsigned)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), nl));
+    for (; m; m &= m - 1)
+      doc_push(c, i + (size_t)__builtin_ctz(m) + 1 - lo);
+  }
+#endif
+  for (; i < end; i++)
+    if (p[i] == '\n')
+      doc_push(c, i + 1 - lo);
+}
+
+/* следующий кусок индекса; 0 — все разобраны */
+static int doc_index_step(void) {
+  if (atomic_load(&doc_next) >= doc_nchunk)
+    return 0;
+  size_t k = atomic_fetch_add(&doc_next, 1);
+  if (k >= doc_nchunk)
+    return 0;
+  size_t lo = k * DOC_CHUNK;
+  size_t hi = lo + DOC_CHUNK < doc_size ? lo + DOC_CHUNK : doc_size;
+  doc_scan(&doc_chunk[k], lo, hi);
+  atomic_store_explicit(&doc_chunk[k].done, 1, memory_order_release);
+  uint64_t one = 1;
+  ssize_t w = write(tick_fd, &one, sizeof(one));
+  (void)w;
+  return 1;
+}
+
+/* забрать готовые куски; → строк, доступных для показа */
+static size_t doc_advance(void) {
+  while (doc_ready < doc_nchunk &&
+         atomic_load_explicit(&doc_chunk[doc_ready].done,
+                              memory_order_acquire)) {
+    doc_first[doc_ready + 1] = doc_first[doc_ready] + doc_chunk[doc_ready].n;
+    doc_ready++;
+  }
+  doc_counted = doc_first[doc_ready];
+  for (size_t k = doc_ready; k < doc_nchunk; k++)
+    if (atomic_load_explicit(&doc_chunk[k].done, memory_order_acquire))
+      doc_counted += doc_chunk[k].n;
+  return doc_first[doc_ready];
+}
+
+/* смещение начала строки line (line < doc_first[doc_ready]) */
+static size_t doc_line_start(size_t line) {
+  size_t lo = 0, hi = doc_ready;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (doc_first[mid] <= line)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return lo * DOC_CHUNK + doc_chunk[lo].start[line - doc_first[lo]];
+}
+
+/* строка, в которой лежит байт off (off — в готовой части) */
+static size_t doc_line_at(size_t off) {
+  size_t k = off / DOC_CHUNK;
+  const DocChunk *c = &doc_chunk[k];
+  size_t rel = off - k * DOC_CHUNK, lo = 0, hi = c->n;
+  while (lo < hi) { /* первое начало > rel */
+    size_t mid = (lo + hi) / 2;
+    if (c->start[mid] <= rel)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return doc_first[k] + lo - 1; /* lo == 0 → последняя строка куска k-1 */
+}
+
+static size_t doc_line_end(size_t start) {
+  const char *nl = memchr(doc_map + start, '\n', doc_size - start);
+  size_t end = nl ? (size_t)(nl - doc_map) : doc_size;
+  if (end > start && doc_map[end - 1] == '\r')
+    end--;
+  return end;
+}
+
+/* строка экрана: табы раскрыты, управляющие байты — '.', обрезка по
+   ширине терминала (UTF-8 считается по символам) */
+static void doc_render(size_t line, int cols, int cur) {
+  char buf[2048];
+  size_t start = doc_line_start(line), end = doc_line_end(start);
+  size_t i = start, n = 0;
+  int col = 0;
+  for (; i < end && n + 8 < sizeof(buf); i++) {
+    unsigned char ch = (unsigned char)doc_map[i];
+    if ((ch & 0xc0) == 0x80) { /* хвост символа */
+      buf[n++] = (char)ch;
+      continue;
+    }
+    if (col >= cols)
+      break;
+    if (ch == '\t') {
+      do
+        buf[n++] = ' ';
+      while (++col % 8 && col < cols);
+      continue;
+    }
+    buf[n++] = ch < 0x20 || ch == 0x7f ? '.' : (char)ch;
+    col++;
+  }
+  if (i < end && ((unsigned char)doc_map[i] & 0xc0) == 0x80)
+    while (n > 0 && ((unsigned char)buf[--n] & 0xc0) == 0x80)
+      ; /* буфер кончился посреди символа */
+  fb_append(cur ? C_CUR "  " : C_DESC "  ");
+  fb_appendn(buf, n);
+  fb_append(RESET "\n");
+}
+
+/* ── DOC SEARCH ─────────────────────────────────────────────────────── */
+/* Запрос режется на куски по SRCH_CHUNK; куски раздаются по очередям
+   потоков, свою очередь поток берёт с головы (ближние к началу поиска —
+   первыми), чужую — крадёт с хвоста. Каждый кусок отдаёт до SRCH_TOP
+   ближайших совпадений в общую max-кучу по расстоянию от начала поиска;
+   кусок, который заведомо дальше худшего из SRCH_TOP, не сканируется.
+   Новая клавиша увеличивает srch_gen: куски старого запроса из очередей
+   выбрасываются, а начатые — дорабатывают свой кусок впустую, UI их не
+   ждёт никогда. Конец запроса — тик в tick_fd, как у индексатора. */
+
+#define SRCH_CHUNK (256 << 10)
+#define SRCH_TOP 64
+
+typedef struct {
+  char q[256];
+  size_t qn;
+  unsigned gen;
+  int dir;              /* 1 — вперёд от lo, -1 — назад от hi */
+  size_t lo, hi;        /* совпадение целиком внутри [lo, hi) */
+  atomic_int left;      /* кусков ещё не отработано */
+  atomic_int refs;      /* куски в очередях и в работе + UI */
+  pthread_mutex_t mu;   /* куча */
+  size_t heap[SRCH_TOP]; /* расстояния от начала поиска, max-куча */
+  int nheap;
+  atomic_size_t worst;  /* heap[0], когда куча полна; иначе SIZE_MAX */
+} SrchJob;
+
+typedef struct {
+  SrchJob *job;
+  size_t lo, hi;
+} SrchTask;
+
+typedef struct {
+  pthread_mutex_t mu;
+  SrchTask *v;
+  size_t head, tail, cap;
+} SrchQueue;
+
+static SrchQueue *srch_q = NULL; /* по очереди на поток, минимум одна */
+static atomic_uint srch_gen;
+static atomic_int srch_queued;    /* кусков во всех очередях */
+static pthread_mutex_t srch_mu = PTHREAD_MUTEX_INITIALIZER; /* сон потоков */
+static pthread_cond_t srch_cv = PTHREAD_COND_INITIALIZER;
+static SrchJob *srch_cur = NULL;  /* последний запрос UI */
+
+static void srch_unref(SrchJob *j) {
+  if (atomic_fetch_sub(&j->refs, 1) == 1) {
+    pthread_mutex_destroy(&j->mu);
+    free(j);
+  }
+}
+
+static void srch_push(SrchQueue *q, SrchTask t) {
+  pthread_mutex_lock(&q->mu);
+  if (q->tail == q->cap) {
+    size_t live = q->tail - q->head;
+    if (q->head > 0) { /* сдвинуть к началу, если есть место */
+      memmove(q->v, q->v + q->head, live * sizeof(*q->v));
+      q->head = 0;
+      q->tail = live;
+    }
+    if (q->tail == q->cap) {
+      size_t nc = q->cap ? q->cap * 2 : 64;
+      SrchTask *tmp = realloc(q->v, nc * sizeof(*q->v));
+      if (!tmp) {
+        pthread_mutex_unlock(&q->mu);
+        atomic_fetch_sub(&t.job->left, 1);
+        srch_unref(t.job);
+        return;
+      }
+      q->v = tmp;
+      q->cap = nc;
+    }
+  }
+  q->v[q->tail++] = t;
+  atomic_fetch_add(&srch_queued, 1);
+  pthread_mutex_unlock(&q->mu);
+}
+
+/* своя очередь — с головы, чужая — с хвоста */
+static int srch_pop(SrchQueue *q, int steal, SrchTask *t) {
+  pthread_mutex_lock(&q->mu);
+  int ok = q->head < q->tail;
+  if (ok) {
+    *t = steal ? q->v[--q->tail] : q->v[q->head++];
+    atomic_fetch_sub(&srch_queued, 1);
+  }
+  pthread_mutex_unlock(&q->mu);
+  return ok;
+}
+
+static void srch_heap_put(SrchJob *j, size_t d) {
+  size_t *h = j->heap;
+  int i;
+  if (j->nheap < SRCH_TOP) {
+    i = j->nheap++;
+    while (i > 0 && h[(i - 1) / 2] < d) {
+      h[i] = h[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+    h[i] = d;
+  } else if (d < h[0]) { /* вытеснить худшее */
+    i = 0;
+    for (int c; (c = 2 * i + 1) < SRCH_TOP; i = c) {
+      if (c + 1 < SRCH_TOP && h[c + 1] > h[c])
+        c++;
+      if (h[c] <= d)
+        break;
+      h[i] = h[c];
+    }
+    h[i] = d;
+  }
+  if (j->nheap == SRCH_TOP)
+    atomic_store(&j->worst, h[0]);
+}
+
+/* кусок [t->lo, t->hi): совпадения, начинающиеся в нём */
+static void srch_chunk(const SrchTask *t) {
+  SrchJob *j = t->job;
+  size_t top = t->hi - 1 + j->qn; /* дальше всех начинающееся в куске */
+  size_t near = j->dir > 0 ? t->lo - j->lo : top < j->hi ? j->hi - top : 0;
+  if (j->gen != atomic_load(&srch_gen) || near >= atomic_load(&j->worst))
+    return;
+  size_t found[SRCH_TOP];
+  int n, total = 0;
+  size_t end = t->hi + j->qn - 1 < j->hi ? t->hi + j->qn - 1 : j->hi;
+  const char *p = doc_map + t->lo, *lim = doc_map + end;
+  const char *hit;
+  while (p < lim && (hit = memmem(p, (size_t)(lim - p), j->q, j->qn)) &&
+         hit < doc_map + t->hi) {
+    size_t off = (size_t)(hit - doc_map);
+    /* вперёд хватит первых SRCH_TOP, назад нужны последние */
+    found[total++ % SRCH_TOP] =
+        j->dir > 0 ? off - j->lo : j->hi - (off + j->qn);
+    if (j->dir > 0 && total == SRCH_TOP)
+      break;
+    p = hit + 1;
+  }
+  n = total < SRCH_TOP ? total : SRCH_TOP;
+  if (!n)
+    return;
+  pthread_mutex_lock(&j->mu);
+  for (int i = 0; i < n; i++)
+    srch_heap_put(j, found[i]);
+  pthread_mutex_unlock(&j->mu);
+}
+
+/* один кусок поиска: своя очередь, потом чужие; 0 — работы нет */
+static int srch_step(int self) {
+  SrchTask t;
+  int got = 0;
+  if (atomic_load(&srch_queued) <= 0)
+    return 0;
+  int nq = doc_nth ? doc_nth : 1;
+  for (int k = 0; k < nq && !got; k++)
+    got = srch_pop(&srch_q[(self + k) % nq], k > 0, &t);
+  if (!got)
+    return 0;
+  srch_chunk(&t);
+  if (atomic_fetch_sub(&t.job->left, 1) == 1) {
+    uint64_t one = 1;
+    ssize_t w = write(tick_fd, &one, sizeof(one));
+    (void)w;
+  }
+  srch_unref(t.job);
+  return 1;
+}
+
+/* выбросить из очередей всё, кроме кусков текущего запроса */
+static void srch_drop_stale(void) {
+  unsigned gen = atomic_load(&srch_gen);
+  for (int k = 0; k < doc_nth; k++) {
+    SrchQueue *q = &srch_q[k];
+    pthread_mutex_lock(&q->mu);
+    size_t w = q->head;
+    for (size_t i = q->head; i < q->tail; i++) {
+      SrchJob *j = q->v[i].job;
+      if (j->gen == gen) {
+        q->v[w++] = q->v[i];
+        continue;
+      }
+      atomic_fetch_sub(&srch_queued, 1);
+      atomic_fetch_sub(&j->left, 1);
+      srch_unref(j);
+    }
+    q->tail = w;
+    pthread_mutex_unlock(&q->mu);
+  }
+}
+
+/* отменить текущий запрос; его результат больше не нужен */
+static void srch_cancel(void) {
+  atomic_fetch_add(&srch_gen, 1);
+  srch_drop_stale();
+  if (srch_cur)
+    srch_unref(srch_cur);
+  srch_cur = NULL;
+}
+
+/* новый запрос: query в [lo, hi), сортировка по близости к lo (dir > 0)
+   или к hi (dir < 0). Не ждёт — итог забирает srch_take */
+static void srch_submit(const char *query, size_t lo, size_t hi, int dir) {
+  srch_cancel();
+  SrchJob *j = calloc(1, sizeof(*j));
+  if (!j)
+    return;
+  snprintf(j->q, sizeof(j->q), "%s", query);
+  j->qn = strlen(j->q);
+  j->gen = atomic_load(&srch_gen);
+  j->dir = dir;
+  j->lo = lo;
+  j->hi = hi;
+  pthread_mutex_init(&j->mu, NULL);
+  atomic_store(&j->worst, SIZE_MAX);
+  size_t n = hi > lo ? (hi - lo + SRCH_CHUNK - 1) / SRCH_CHUNK : 0;
+  atomic_store(&j->left, (int)n + 1); /* +1 — пока раздаём */
+  atomic_store(&j->refs, (int)n + 1);
+  srch_cur = j;
+  /* вперёд — ближние куски в голову очередей, назад — наоборот */
+  for (size_t i = 0; i < n; i++) {
+    size_t k = dir > 0 ? i : n - 1 - i;
+    size_t clo = lo + k * SRCH_CHUNK;
+    size_t chi = clo + SRCH_CHUNK < hi ? clo + SRCH_CHUNK : hi;
+    srch_push(&srch_q[doc_nth ? (int)(i % (size_t)doc_nth) : 0],
+              (SrchTask){j, clo, chi});
+  }
+  if (atomic_fetch_sub(&j->left, 1) == 1) { /* пустой диапазон */
+    uint64_t one = 1;
+    ssize_t w = write(tick_fd, &one, sizeof(one));
+    (void)w;
+  }
+  if (doc_nth == 0) { /* без потоков — сами */
+    while (srch_step(0))
+      ;
+    return;
+  }
+  pthread_mutex_lock(&srch_mu);
+  pthread_cond_broadcast(&srch_cv);
+  pthread_mutex_unlock(&srch_mu);
+}
+
+/* итог текущего запроса: строки с совпадениями по близости, без
+   повторов; → их число, -1 — ещё считается. *more — за последней
+   найденной в диапазоне могут быть ещё */
+static int srch_take(long *lines, size_t ready, int *more) {
+  SrchJob *j = srch_cur;
+  if (!j || atomic_load(&j->left) > 0)
+    return -1;
+  pthread_mutex_lock(&j->mu); /* видеть кучу целиком */
+  size_t d[SRCH_TOP];
+  int n = j->nheap;
+  memcpy(d, j->heap, (size_t)n * sizeof(*d));
+  pthread_mutex_unlock(&j->mu);
+  for (int i = 1; i < n; i++) /* n ≤ 64: вставками */
+    for (int k = i; k > 0 && d[k] < d[k - 1]; k--) {
+      size_t t = d[k];
+      d[k] = d[k - 1];
+      d[k - 1] = t;
+    }
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    size_t off = j->dir > 0 ? j->lo + d[i] : j->hi - d[i] - j->qn;
+    size_t line = doc_line_at(off);
+    if (line < ready && (m == 0 || lines[m - 1] != (long)line))
+      lines[m++] = (long)line;
+  }
+  *more = n == SRCH_TOP;
+  srch_unref(j);
+  srch_cur = NULL;
+  return m;
+}
+
+/* поток пула: поиск важнее индекса, без работы — спит */
+static void *doc_worker(void *arg) {
+  int self = (int)(intptr_t)arg;
+  while (!atomic_load(&doc_stop)) {
+    if (self >= 0 && srch_step(self))
+      continue;
+    if (doc_index_step())
+      continue;
+    if (self < 0) /* вызван без потоков: только индекс */
+      break;
+    pthread_mutex_lock(&srch_mu);
+    while (!atomic_load(&doc_stop) && atomic_load(&srch_queued) <= 0)
+      pthread_cond_wait(&srch_cv, &srch_mu);
+    pthread_mutex_unlock(&srch_mu);
+  }
+  return NULL;
+}
+
+/* mmap + запуск индексатора; не ждёт его */
+static int doc_open(const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "%s: %s: %s\n", tutor->name, path, strerror(errno));
+    return 1;
+  }
+  doc_size = (size_t)st.st_size;
+  doc_map = doc_size ? mmap(NULL, doc_size, PROT_READ, MAP_PRIVATE, fd, 0)
+                     : "";
+  close(fd);
+  if (doc_map == MAP_FAILED) {
+    fprintf(stderr, "%s: %s: %s\n", tutor->name, path, strerror(errno));
+    return 1;
+  }
+
+  doc_nchunk = (doc_size + DOC_CHUNK - 1) / DOC_CHUNK;
+  doc_chunk = calloc(doc_nchunk ? doc_nchunk : 1, sizeof(DocChunk));
+  doc_first = calloc(doc_nchunk + 1, sizeof(size_t));
+  tick_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (!doc_chunk || !doc_first || tick_fd < 0)
+    return 1;
+  /* пул — по ядрам, а не по кускам индекса: поиск режется мельче
+     (SRCH_CHUNK), лишние потоки после индекса просто спят на srch_cv */
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int nq = ncpu < 1 ? 1 : ncpu > 1024 ? 1024 : (int)ncpu;
+  doc_th = calloc((size_t)nq, sizeof(*doc_th));
+  srch_q = calloc((size_t)nq, sizeof(*srch_q));
+  if (!doc_th || !srch_q)
+    return 1;
+  for (int i = 0; i < nq; i++)
+    pthread_mutex_init(&srch_q[i].mu, NULL);
+  doc_nth = nq;
+  for (int i = 0; i < doc_nth; i++)
+    if (pthread_create(&doc_th[i], NULL, doc_worker, (void *)(intptr_t)i) !=
+        0) {
+      doc_nth = i;
+      break;
+    }
+  if (doc_nth == 0) /* без потоков — всё сразу здесь */
+    doc_worker((void *)(intptr_t)-1);
+  return 0;
+}
+
+/* запрос от строки from в сторону dir (назад — включая её саму);
+   0 — искать нечего */
+static int doc_search(const char *query, long from, int dir, size_t ready) {
+  if (!query[0] || from < 0 || (size_t)from >= ready) {
+    srch_cancel();
+    return 0;
+  }
+  /* только готовая часть: doc_line_at знает лишь её */
+  size_t lim = doc_ready < doc_nchunk ? doc_ready * DOC_CHUNK : doc_size;
+  size_t start = doc_line_start((size_t)from);
+  size_t end = doc_line_end(start);
+  if (dir > 0)
+    srch_submit(query, start, lim, 1);
+  else
+    srch_submit(query, 0, end < lim ? end : lim, -1);
+  return 1;
+}
+
+/* n/N по итогу прошлого запроса: ближайшая строка за cursor, если итог
+   её покрывает; -1 — совпадений дальше нет, -2 — надо искать заново */
+static long doc_hit_next(const long *hits, int nhits, int more, int hdir,
+                         long hfrom, long cursor, int dir) {
+  if (hdir != dir || (dir > 0 ? cursor + 1 < hfrom : cursor - 1 > hfrom))
+    return -2;
+  for (int i = 0; i < nhits; i++)
+    if (dir > 0 ? hits[i] > cursor : hits[i] < cursor)
+      return hits[i];
+  return more ? -2 : -1;
+}
+
+static int doc_view(const char *path) {
+  if (doc_open(path) != 0)
+    return 1;
+  term_open();
+  atexit(term_restore);
+
+  const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+  size_t ready = doc_advance();
+  long cursor = 0, offset = 0;
+  int last_g = 0;
+  char query[256] = "";
+  size_t qlen = 0;
+  int searching = 0;
+  long search_from = 0;
+  int not_found = 0;
+  /* итог последнего запроса (DOC SEARCH): строки по близости к hfrom */
+  long hits[SRCH_TOP], hfrom = 0;
+  int nhits = 0, more = 0, hdir = 0, waiting = 0;
+  size_t hready = 0;
+
+  fb_append(CUR_HIDE);
+  fb_flush();
+
+  while (1) {
+    int rows = term_rows(), cols = term_cols() - 2;
+    long visible = rows - 2;
+    if (cursor >= (long)ready)
+      cursor = (long)ready - 1;
+    if (cursor < 0)
+      cursor = 0;
+    if (cursor < offset)
+      offset = cursor;
+    if (cursor >= offset + visible)
+      offset = cursor - visible + 1;
+
+    fb_reset();
+    fb_append(CLR);
+    for (long i = offset; i < offset + visible && i < (long)ready; i++)
+      doc_render((size_t)i, cols, i == cursor);
+    for (long i = (long)ready - offset; i < visible; i++)
+      fb_append("\n");
+    fb_append(
+        C_SEP
+        "  ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n" RESET);
+    if (searching)
+      fb_appendf(C_KEY "  /%s" RESET "█%s", query,
+                 waiting     ? C_SEP "  …" RESET
+                 : not_found ? C_SEP "  [не найдено]" RESET
+                             : "");
+    else
+      fb_appendf(C_HINT "  %s  j/k↕  d/u ½  gg/G  / поиск  n/N  q выход" C_SEP
+                        "  [%ld/%zu%s]%s" RESET,
+                 name, ready ? cursor + 1 : 0, doc_counted,
+                 doc_ready < doc_nchunk ? "…" : "",
+                 not_found ? "  [не найдено]" : "");
+    fb_present();
+
+    int key = searching ? read_key_raw() : read_key();
+    if (key == KEY_TICK) {
+      uint64_t v;
+      ssize_t r = read(tick_fd, &v, sizeof(v));
+      (void)r;
+      ready = doc_advance();
+      int n = waiting ? srch_take(hits, ready, &more) : -1;
+      if (n >= 0) { /* запрос досчитан — туда, куда он вёл */
+        waiting = 0;
+        nhits = n;
+        hready = ready;
+        if (n > 0)
+          cursor = hits[0];
+        else if (searching)
+          cursor = search_from;
+        not_found = n == 0;
+      }
+      continue;
+    }
+    if (searching) {
+      int edited = 1;
+      if (key == '\r' || key == '\n') {
+        searching = 0; /* недосчитанный запрос ещё передвинет курсор */
+        edited = 0;
+      } else if (key == 27 || key == -1) {
+        searching = 0;
+        not_found = 0;
+        cursor = search_from;
+        srch_cancel();
+        waiting = 0;
+        edited = 0;
+      } else if (key == 127 || key == 8) {
+        while (qlen > 0 && ((unsigned char)query[--qlen] & 0xc0) == 0x80)
+          ;
+        query[qlen] = '\0';
+      } else if (key >= 0x20 && key < KEY_UP && qlen + 4 < sizeof(query)) {
+        qlen += (size_t)tv_utf8_put(query + qlen, key);
+        query[qlen] = '\0';
+      } else {
+        edited = 0;
+      }
+      if (edited) { /* старый запрос отменяется, новый — в пул */
+        waiting = doc_search(query, search_from, 1, ready);
+        nhits = 0;
+        hdir = 1;
+        hfrom = search_from;
+        not_found = !waiting && qlen > 0; /* искать негде */
+        if (!waiting)
+          cursor = search_from;
+      }
+      continue;
+    }
+    not_found = 0;
+
+    if (key == 'j') {
+      cursor++;
+      last_g = 0;
+    } else if (key == 'k') {
+      cursor--;
+      last_g = 0;
+    } else if (key == 'd') {
+      cursor += visible / 2;
+      last_g = 0;
+    } else if (key == 'u') {
+      cursor -= visible / 2;
+      last_g = 0;
+    } else if (key == 'g') {
+      if (last_g) {
+        cursor = 0;
+        last_g = 0;
+      } else
+        last_g = 1;
+    } else if (key == 'G') {
+      cursor = (long)ready - 1;
+      last_g = 0;
+    } else if (key == '/') {
+      searching = 1;
+      search_from = cursor;
+      qlen = 0;
+      query[0] = '\0';
+      last_g = 0;
+    } else if (key == 'n' || key == 'N') {
+      int dir = key == 'n' ? 1 : -1;
+      long hit = hready == ready && !waiting
+                     ? doc_hit_next(hits, nhits, more, hdir, hfrom, cursor, dir)
+                     : -2;
+      if (hit >= 0)
+        cursor = hit;
+      else if (hit == -1)
+        not_found = qlen > 0;
+      else if ((waiting = doc_search(query, cursor + dir, dir, ready))) {
+        nhits = 0;
+        hdir = dir;
+        hfrom = cursor + dir;
+      } else
+        not_found = qlen > 0;
+      last_g = 0;
+    } else if (key == 'q' || key == 'x' || key == 27 || key == -1) {
+      break;
+    } else {
+      last_g = 0;
+    }
+  }
+
+  atomic_store(&doc_stop, 1);
+  pthread_mutex_lock(&srch_mu);
+  pthread_cond_broadcast(&srch_cv);
+  pthread_mutex_unlock(&srch_mu);
+  for (int i = 0; i < doc_nth; i++)
+    pthread_join(doc_th[i], NULL);
+  srch_cancel();
+  term_close();
+  return 0;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   MENU FRAME
+   Меню встроенных секций без «Недавних» — готовый кадр из сборки
+   (-DTUTOR_GENKEYS рисует его тем же tv_menu): кадр без выделенного
+   пункта плюс для каждого пункта — чем заменить кусок at[2i]..at[2i+1],
+   чтобы он стал выделенным. print_menu только склеивает три куска.
+   ══════════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+  int n;
+  const char *frame;
+  unsigned len;
+  const unsigned *at;     /* [2n]: заменяемый кусок кадра для пункта i */
+  const char *cur;        /* выделенные пункты подряд */
+  const unsigned *cur_at; /* [n + 1] */
+} MenuFrame;
+
+/* подсказка под меню: Tab ведёт к следующей шпаргалке */
+static void menu_hint(int t, char *buf, size_t cap) {
+  snprintf(buf, cap,
+           C_HINT "  j/k выбор   l/Enter открыть   %% край↔край   Tab → %s   "
+                  "q выход\n" RESET,
+           tutors[(t + 1) % TUTORS_N]->alias);
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   KEY INDEX
+   Ключи R:-строк для -k и дополнения. Точное совпадение — минимальный
+   perfect hash, префикс — отсортированный front-coded массив. Таблицы
+   строит сам tutor при сборке (-DTUTOR_GENKEYS) и они лежат в .rodata.
+   Хэш — key_hash из HISTORY.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define KEYS_BUCKET 16 /* каждый 16-й ключ хранится целиком */
+
+/* таблицы одной шпаргалки, key_index[] — в порядке tutors[] */
+typedef struct {
+  int n, mph_b;
+  const unsigned char *fc;
+  const unsigned *restart;
+  const unsigned short *mph_disp, *mph_rank, *hit_first;
+  const unsigned *hits;
+} KeyIndex;
+
+#ifdef TUTOR_GENKEYS
+
+/* "R:key|desc" → длина key */
+static size_t row_key_len(const char *content) {
+  const char *pipe = strchr(content, '|');
+  return pipe ? (size_t)(pipe - content) : strlen(content);
+}
+
+typedef struct {
+  const char *key;
+  size_t len;
+  unsigned hit; /* (секция << 16) | строка */
+} GenKey;
+
+static int genkey_cmp(const void *a, const void *b) {
+  const GenKey *x = a, *y = b;
+  size_t n = x->len < y->len ? x->len : y->len;
+  int c = memcmp(x->key, y->key, n);
+  if (c)
+    return c;
+  if (x->len != y->len)
+    return x->len < y->len ? -1 : 1;
+  return x->hit < y->hit ? -1 : x->hit > y->hit;
+}
+
+static void gen_array(const char *type, const char *alias, const char *name,
+                      const unsigned *v, int n) {
+  printf("static const %s %s_%s[%d] = {", type, alias, name, n);
+  for (int i = 0; i < n; i++)
+    printf("%s%u,", i % 12 ? " " : "\n    ", v[i]);
+  printf("\n};\n\n");
+}
+
+/* CHD-подобный поиск: для каждого bucket'а подбираем seed, раскидывающий
+   его ключи по свободным слотам; большие bucket'ы — первыми. 0 — не
+   вышло (или bucket больше MPH_BUCKET_MAX): корзин нужно больше */
+#define MPH_BUCKET_MAX 64
+
+static int gen_mph(GenKey *uk, int n, int nb, unsigned *disp, unsigned *rank) {
+  int *bsize = calloc((size_t)nb, sizeof(int));
+  int *order = malloc((size_t)nb * sizeof(int));
+  char *used = calloc((size_t)n, 1);
+  int ok = 1;
+
+  for (int i = 0; i < n; i++)
+    bsize[key_hash(uk[i].key, uk[i].len, 0) % (unsigned)nb]++;
+  for (int b = 0; b < nb; b++)
+    order[b] = b;
+  for (int i = 1; i < nb; i++) /* insertion sort по убыванию размера */
+    for (int j = i; j > 0 && bsize[order[j]] > bsize[order[j - 1]]; j--) {
+      int t = order[j];
+      order[j] = order[j - 1];
+      order[j - 1] = t;
+    }
+
+  for (int b = 0; b < nb; b++)
+    if (bsize[b] > MPH_BUCKET_MAX)
+      ok = 0;
+
+  for (int oi = 0; oi < nb && ok; oi++) {
+    int b = order[oi];
+    disp[b] = 0;
+    if (!bsize[b])
+      continue;
+    /* rank пишем только для принятого seed: неудачный затёр бы слоты,
+       уже занятые прежними bucket'ами */
+    unsigned slots[MPH_BUCKET_MAX], ranks[MPH_BUCKET_MAX];
+    for (unsigned d = 1; d < 65536; d++) {
+      int m = 0, clash = 0;
+      for (int i = 0; i < n && !clash; i++) {
+        if (key_hash(uk[i].key, uk[i].len, 0) % (unsigned)nb != (unsigned)b)
+          continue;
+        unsigned sl = key_hash(uk[i].key, uk[i].len, d) % (unsigned)n;
+        clash = used[sl];
+        for (int k = 0; k < m && !clash; k++)
+          clash = slots[k] == sl;
+        slots[m] = sl;
+        ranks[m++] = (unsigned)i;
+      }
+      if (!clash) {
+        for (int k = 0; k < m; k++) {
+          used[slots[k]] = 1;
+          rank[slots[k]] = ranks[k];
+        }
+        disp[b] = d;
+        break;
+      }
+    }
+    ok = disp[b] != 0;
+  }
+
+  free(bsize);
+  free(order);
+  free(used);
+  return ok;
+}
+
+/* таблицы шпаргалки t; → число ключей, *mph_b — корзин хэша */
+static int gen_tutor(const Tutor *t, int *mph_b) {
+  int cap = 1024, total = 0;
+  GenKey *all = malloc((size_t)cap * sizeof(GenKey));
+  for (int s = 0; s < t->n; s++)
+    for (int i = 0; t->sections[s][i]; i++) {
+      const char *line = t->sections[s][i];
+      if (line[0] != 'R')
+        continue;
+      if (total == cap)
+        all = realloc(all, (size_t)(cap *= 2) * sizeof(GenKey));
+      all[total].key = line + 2;
+      all[total].len = row_key_len(line + 2);
+      if (all[total].len > 255) { /* длина — байт во front coding */
+        fprintf(stderr, "%s: ключ длиннее 255 байт: %.40s...\n", t->name,
+                line + 2);
+        exit(1);
+      }
+      all[total].hit = ((unsigned)s << 16) | (unsigned)i;
+      total++;
+    }
+  qsort(all, (size_t)total, sizeof(GenKey), genkey_cmp);
+
+  /* уникальные ключи + диапазоны попаданий */
+  GenKey *uk = malloc((size_t)total * sizeof(GenKey));
+  unsigned *first = malloc((size_t)(total + 1) * sizeof(unsigned));
+  unsigned *hits = malloc((size_t)total * sizeof(unsigned));
+  int n = 0;
+  for (int i = 0; i < total; i++) {
+    if (!n || uk[n - 1].len != all[i].len ||
+        memcmp(uk[n - 1].key, all[i].key, all[i].len)) {
+      first[n] = (unsigned)i;
+      uk[n++] = all[i];
+    }
+    hits[i] = all[i].hit;
+  }
+  first[n] = (unsigned)total;
+
+  /* front coding: [lcp][len суффикса][суффикс] */
+  unsigned *fc = malloc((size_t)total * 258 * sizeof(unsigned));
+  unsigned *restart = malloc((size_t)(n / KEYS_BUCKET + 1) * sizeof(unsigned));
+  int fcn = 0;
+  for (int i = 0; i < n; i++) {
+    size_t lcp = 0;
+    if (i % KEYS_BUCKET == 0)
+      restart[i / KEYS_BUCKET] = (unsigned)fcn;
+    else
+      while (lcp < uk[i].len && lcp < uk[i - 1].len && lcp < 255 &&
+             uk[i].key[lcp] == uk[i - 1].key[lcp])
+        lcp++;
+    size_t sl = uk[i].len - lcp;
+    fc[fcn++] = (unsigned)lcp;
+    fc[fcn++] = (unsigned)sl;
+    for (size_t k = 0; k < sl; k++)
+      fc[fcn++] = (unsigned char)uk[i].key[lcp + k];
+  }
+
+  int nb = n / 4 + 1;
+  unsigned *disp = malloc((size_t)nb * sizeof(unsigned));
+  unsigned *rank = calloc((size_t)(n ? n : 1), sizeof(unsigned));
+  while (n && !gen_mph(uk, n, nb, disp, rank)) {
+    nb += nb / 4 + 1;
+    disp = realloc(disp, (size_t)nb * sizeof(unsigned));
+  }
+
+  gen_array("unsigned char", t->alias, "keys_fc", fc, fcn);
+  gen_array("unsigned", t->alias, "keys_restart", restart,
+            (n + KEYS_BUCKET - 1) / KEYS_BUCKET);
+  gen_array("unsigned short", t->alias, "keys_mph_disp", disp, nb);
+  gen_array("unsigned short", t->alias, "keys_mph_rank", rank, n);
+  gen_array("unsigned short", t->alias, "keys_hit_first", first, n + 1);
+  gen_array("unsigned", t->alias, "keys_hits", hits, total);
+  free(all);
+  free(uk);
+  free(first);
+  free(hits);
+  free(fc);
+  free(restart);
+  free(disp);
+  free(rank);
+  *mph_b = nb;
+  return n;
+}
+
+typedef struct {
+  char *buf;
+  size_t len, cap;
+} GenBuf;
+
+static void gen_sink(void *user, const char *buf, size_t n) {
+  GenBuf *b = user;
+  if (b->len + n > b->cap) {
+    b->cap = (b->len + n) * 2;
+    b->buf = realloc(b->buf, b->cap);
+  }
+  memcpy(b->buf + b->len, buf, n);
+  b->len += n;
+}
+
+/* строковый литерал, по строке исходника на строку экрана */
+static void gen_str(const char *alias, const char *name, const char *s,
+                    size_t n) {
+  printf("static const char %s_%s[] =\n    \"", alias, name);
+  for (size_t i = 0; i < n; i++) {
+    unsigned char c = (unsigned char)s[i];
+    if (c == '"' || c == '\\')
+      printf("\\%c", c);
+    else if (c == '\n')
+      printf("\\n\"%s", i + 1 < n ? "\n    \"" : "");
+    else if (c < 0x20 || c == 0x7f)
+      printf("\\%03o", c);
+    else
+      putchar(c);
+  }
+  printf("%s;\n\n", n && s[n - 1] == '\n' ? "" : "\"");
+}
+
+static void gen_menu(int ti) {
+  const Tutor *t = tutors[ti];
+  GenBuf plain = {0}, sel = {0}, cur = {0};
+  TutorView v;
+  char hint[256];
+  unsigned *at = malloc(sizeof(unsigned) * (size_t)t->n * 2);
+  unsigned *cur_at = malloc(sizeof(unsigned) * (size_t)(t->n + 1));
+  menu_hint(ti, hint, sizeof(hint));
+
+  tv_init(&v, t, gen_sink, &plain);
+  tv_menu(&v, t->labels, t->n, 0, -1, hint);
+  v.user = &sel;
+  for (int i = 0; i < t->n; i++) {
+    sel.len = 0;
+    tv_menu(&v, t->labels, t->n, 0, i, hint);
+    /* отличие от кадра без выделения — общие начало и конец отрезаем */
+    size_t p = 0, e = 0;
+    while (p < plain.len && p < sel.len && plain.buf[p] == sel.buf[p])
+      p++;
+    while (e < plain.len - p && e < sel.len - p &&
+           plain.buf[plain.len - 1 - e] == sel.buf[sel.len - 1 - e])
+      e++;
+    at[2 * i] = (unsigned)p;
+    at[2 * i + 1] = (unsigned)(plain.len - e);
+    cur_at[i] = (unsigned)cur.len;
+    gen_sink(&cur, sel.buf + p, sel.len - e - p);
+  }
+  cur_at[t->n] = (unsigned)cur.len;
+
+  gen_str(t->alias, "menu_frame", plain.buf, plain.len);
+  gen_array("unsigned", t->alias, "menu_at", at, t->n * 2);
+  gen_str(t->alias, "menu_cur", cur.buf, cur.len);
+  gen_array("unsigned", t->alias, "menu_cur_at", cur_at, t->n + 1);
+  tv_free(&v);
+  free(plain.buf);
+  free(sel.buf);
+  free(cur.buf);
+  free(at);
+  free(cur_at);
+}
+
+int main(void) {
+  int n[TUTORS_N], nb[TUTORS_N];
+  printf("/* generated from tutor.c by -DTUTOR_GENKEYS — do not edit */\n\n");
+  for (int i = 0; i < TUTORS_N; i++) {
+    n[i] = gen_tutor(tutors[i], &nb[i]);
+    gen_menu(i);
+  }
+  printf("static const KeyIndex key_index[%d] = {\n", TUTORS_N);
+  for (int i = 0; i < TUTORS_N; i++) {
+    const char *a = tutors[i]->alias;
+    printf("    {%d, %d, %s_keys_fc, %s_keys_restart, %s_keys_mph_disp,\n"
+           "     %s_keys_mph_rank, %s_keys_hit_first, %s_keys_hits},\n",
+           n[i], nb[i], a, a, a, a, a, a);
+  }
+  printf("};\n\n");
+  printf("static const MenuFrame menu_frame[%d] = {\n", TUTORS_N);
+  for (int i = 0; i < TUTORS_N; i++) {
+    const char *a = tutors[i]->alias;
+    printf("    {%d, %s_menu_frame, sizeof(%s_menu_frame) - 1, %s_menu_at,\n"
+           "     %s_menu_cur, %s_menu_cur_at},\n",
+           tutors[i]->n, a, a, a, a, a);
+  }
+  printf("};\n");
+  return 0;
+}
+
+#else
+
+#include "tutor_keys.h"
+
+static const KeyIndex *keys = &key_index[0]; /* текущей шпаргалки */
+
+/* только указатели; контент грузит content_load */
+static void tutor_select(int i) {
+  tutor_idx = i;
+  tutor = tutors[i];
+  keys = &key_index[i];
+}
+
+/* "gitutor", "/usr/bin/zshtutor", "git" → индекс, иначе -1 */
+static int tutor_find(const char *name) {
+  const char *base = strrchr(name, '/');
+  base = base ? base + 1 : name;
+  for (int i = 0; i < TUTORS_N; i++)
+    if (!strcmp(base, tutors[i]->name) || !strcmp(base, tutors[i]->alias))
+      return i;
+  return -1;
+}
+
+/* ключ номер rank (в порядке сортировки) → out, возвращает длину */
+static size_t keys_decode(int rank, char *out) {
+  const unsigned char *p = keys->fc + keys->restart[rank / KEYS_BUCKET];
+  size_t len = 0;
+  for (int i = rank - rank % KEYS_BUCKET; i <= rank; i++) {
+    memcpy(out + p[0], p + 2, p[1]);
+    len = (size_t)p[0] + p[1];
+    p += 2 + p[1];
+  }
+  out[len] = '\0';
+  return len;
+}
+
+static int keys_exact(const char *q) {
+  size_t n = strlen(q);
+  char buf[512];
+  unsigned b = key_hash(q, n, 0) % keys->mph_b;
+  unsigned slot = key_hash(q, n, keys->mph_disp[b]) % keys->n;
+  int rank = keys->mph_rank[slot];
+  if (keys_decode(rank, buf) == n && !memcmp(buf, q, n))
+    return rank;
+  return -1;
+}
+
+/* первый rank с ключом >= q: бинпоиск по restart-точкам, потом линейно */
+static int keys_lower_bound(const char *q) {
+  int lo = 0, hi = (keys->n + KEYS_BUCKET - 1) / KEYS_BUCKET;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    const unsigned char *p = keys->fc + keys->restart[mid];
+    size_t n = strlen(q) < p[1] ? strlen(q) : p[1];
+    int c = memcmp(p + 2, q, n);
+    if (c < 0 || (c == 0 && p[1] < strlen(q)))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  char buf[512];
+  int rank = lo > 0 ? (lo - 1) * KEYS_BUCKET : 0;
+  for (; rank < keys->n; rank++) {
+    keys_decode(rank, buf);
+    if (strcmp(buf, q) >= 0)
+      break;
+  }
+  return rank;
+}
+
+static void keys_emit_row(int sec, const char *content, size_t klen) {
+  const char *desc = content + klen;
+  if (*desc == '|')
+    desc++;
+  fb_appendn(content, klen);
+  fb_append("\t");
+  fb_append(desc);
+  fb_append("\t");
+  fb_append(sections[sec].id);
+  fb_append("\n");
+}
+
+static void keys_emit(int rank) {
+  char key[512];
+  size_t klen = keys_decode(rank, key);
+  for (unsigned h = keys->hit_first[rank]; h < keys->hit_first[rank + 1]; h++) {
+    int sec = (int)(keys->hits[h] >> 16);
+    keys_emit_row(sec, sec_lines(sec)[keys->hits[h] & 0xffff] + 2, klen);
+  }
+}
+
+/* секции из .tut-файлов индекс не описывает — тогда просто перебор:
+   сначала точные совпадения, потом префиксы в порядке секций */
+static void keys_scan(const char *q) {
+  size_t qn = strlen(q);
+  for (int pass = 0; pass < 2; pass++)
+    for (int s = 0; s < nsections; s++)
+      for (const char **l = sec_lines(s); *l; l++) {
+        const char *line = *l;
+        size_t klen = strcspn(line + 2, "|");
+        if (line[0] == 'R' && klen >= qn && !memcmp(line + 2, q, qn) &&
+            (klen == qn) == (pass == 0))
+          keys_emit_row(s, line + 2, klen);
+      }
+}
+
+/* -k: точное совпадение (если есть), затем остальные ключи с префиксом */
+static int keys_print(const char *q) {
+  size_t qn = strlen(q);
+  char buf[512];
+  if (content_external) {
+    keys_scan(q);
+  } else {
+    int exact = keys->n ? keys_exact(q) : -1;
+    if (exact >= 0)
+      keys_emit(exact);
+    for (int r = keys_lower_bound(q); r < keys->n; r++) {
+      if (keys_decode(r, buf) < qn || memcmp(buf, q, qn))
+        break;
+      if (r != exact)
+        keys_emit(r);
+    }
+  }
+  int found = fbuf_len > 0;
+  fb_flush();
+  return found ? 0 : 1;
+}
+
+/* ── zsh completion ─────────────────────────────────────────────────── */
+/* одна функция на tutor и все алиасы: шпаргалка — по $service или -t */
+static int zsh_completion(void) {
+  fb_append("#compdef tutor");
+  for (int t = 0; t < TUTORS_N; t++)
+    fb_appendf(" %s", tutors[t]->name);
+  fb_append("\n\n"
+            "# generated by `tutor --zsh-completion`\n\n"
+            "_tutor() {\n"
+            "  local context state state_descr line l rest t\n"
+            "  local -a args sections keys\n"
+            "  typeset -A opt_args\n"
+            "  args=(\n"
+            "    '-s[открыть секцию]:секция:->section'\n"
+            "    '-k[найти команду по ключу или префиксу]:команда:->key'\n"
+            "    '--zsh-completion[вывести функцию дополнения]'\n"
+            "    '--init-content[выгрузить секции в .tut-файлы]'\n"
+            "    '--pack[собрать .tut-файлы в pack]'\n"
+            "    '(- *)-h[справка]'\n"
+            "  )\n"
+            "  [[ $service == tutor ]] &&\n"
+            "    args+=('-t[шпаргалка]:шпаргалка:(");
+  for (int t = 0; t < TUTORS_N; t++)
+    fb_appendf(t ? " %s" : "%s", tutors[t]->alias);
+  fb_append(")')\n"
+            "  _arguments -s $args\n"
+            "  case $service in\n");
+  for (int t = 0; t < TUTORS_N; t++)
+    fb_appendf("    %s) t=%s ;;\n", tutors[t]->name, tutors[t]->alias);
+  fb_appendf("    *) t=${opt_args[-t]:-%s} ;;\n"
+             "  esac\n"
+             "  case $state in\n"
+             "    section)\n"
+             "      case $t in\n",
+             tutors[0]->alias);
+  for (int t = 0; t < TUTORS_N; t++) {
+    tutor_select(t);
+    content_load(1);
+    fb_appendf("        %s) sections=(\n", tutor->alias);
+    for (int i = 0; i < nsections; i++) {
+      fb_appendf("          '%s:", sections[i].id);
+      for (const char *p = sections[i].label; *p; p++)
+        fb_append(*p == '\'' ? "'\\''" : (char[2]){*p, 0});
+      fb_append("'\n");
+    }
+    fb_append("        ) ;;\n");
+  }
+  fb_append(
+      "      esac\n"
+      "      _describe -t sections 'секция' sections ;;\n"
+      "    key)\n"
+      "      for l in ${(f)\"$(tutor -t $t -k \"${(Q)PREFIX}\" 2>/dev/null)\"};"
+      " do\n"
+      "        rest=${l#*$'\\t'}\n"
+      "        keys+=(\"${${l%%$'\\t'*}//:/\\\\:}:${rest%%$'\\t'*}\")\n"
+      "      done\n"
+      "      _describe -t keys 'команда' keys ;;\n"
+      "  esac\n"
+      "}\n\n"
+      "_tutor \"$@\"\n");
+  fb_flush();
+  return 0;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   SPLIT PANE
+   На широком экране меню слева, справа — секция под курсором. Каждая
+   панель помнит, что сейчас на экране, построчно; кадр — только строки,
+   которые изменились, каждая со своим CUP. j/k в меню — две строки меню
+   и те строки превью, что отличаются; экран целиком не стирается
+   никогда: панели вместе покрывают его полностью. Превью — flat из
+   RENDER CACHE (копия указателей), без кэша строится один раз на пункт.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define SPLIT_MIN 160 /* уже — меню на весь экран, как раньше */
+#define SPLIT_LINE 2048
+#define SPLIT_BAR C_SEP "│ " RESET /* разделитель перед строкой превью */
+
+typedef struct {
+  int col, width; /* с какой колонки (с 1) и сколько ячеек под текст */
+  int eol;        /* панель до края экрана: хвост — CSI K, не пробелы */
+  char **shown;   /* что на экране, NULL — неизвестно */
+  char **next;    /* кадр, ещё не показанный */
+} SplitPane;
+
+static SplitPane split_pane[2];
+static int split_h = 0, split_w = 0; /* размер экрана; 0 — всё заново */
+static int split_left = 0;           /* ширина панели меню */
+static TvFlat split_flat;            /* превью */
+static int split_sec, split_have = 0;
+static unsigned split_gen;
+
+/* на экране теперь неизвестно что: следующий кадр — все строки */
+static void split_reset(void) {
+  for (int p = 0; p < 2; p++) {
+    for (int r = 0; r < split_h; r++) {
+      free(split_pane[p].shown[r]);
+      free(split_pane[p].next[r]);
+    }
+    free(split_pane[p].shown);
+    free(split_pane[p].next);
+    split_pane[p].shown = split_pane[p].next = NULL;
+  }
+  split_h = split_w = split_left = 0;
+  split_have = 0;
+}
+
+/* s[0..n) → out: из escape-последовательностей только SGR, текста не
+   больше width ячеек (*w — сколько вышло). carry — SGR, действующий с
+   прошлых строк: баннер красит все свои строки одним C_BANNER */
+static size_t split_fit(const char *s, size_t n, int width, char *out,
+                        size_t cap, char *carry, int *w) {
+  size_t o = 0;
+  *w = 0;
+  for (size_t i = 0; i < n;) {
+    unsigned char c = (unsigned char)s[i];
+    size_t len = 1;
+    if (c == 27 && i + 1 < n && s[i + 1] == '[') {
+      size_t j = i + 2;
+      while (j < n &&
+             ((unsigned char)s[j] < 0x40 || (unsigned char)s[j] > 0x7e))
+        j++;
+      len = j < n ? j + 1 - i : n - i;
+      if (j < n && s[j] == 'm' && o + len < cap) {
+        memcpy(out + o, s + i, len);
+        o += len;
+        if (carry && (len == 3 || (len == sizeof(RESET) - 1 &&
+                                   !memcmp(s + i, RESET, len))))
+          carry[0] = '\0';
+        else if (carry && strlen(carry) + len < 64)
+          strncat(carry, s + i, len);
+      }
+    } else if (c >= 0x20 && c != 0x7f && (c & 0xc0) != 0x80) {
+      len = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+      if (i + len > n)
+        break;
+      if (*w < width && o + len < cap) {
+        memcpy(out + o, s + i, len);
+        o += len;
+        (*w)++;
+      }
+    } /* прочие управляющие (\r, CLR) — не нужны, строки ставит CUP */
+    i += len;
+  }
+  return o;
+}
+
+/* строка r панели p в следующий кадр */
+static void split_row(SplitPane *p, int r, const char *lead, const char *s,
+                      size_t n, char *carry) {
+  char buf[SPLIT_LINE];
+  size_t o = (size_t)snprintf(buf, sizeof(buf), RESET "%s%s", lead,
+                              carry ? carry : "");
+  int w;
+  o += split_fit(s, n, p->width, buf + o, sizeof(buf) - o - 128, carry, &w);
+  memcpy(buf + o, RESET, sizeof(RESET) - 1);
+  o += sizeof(RESET) - 1;
+  if (p->eol) {
+    memcpy(buf + o, "\033[K", 3);
+    o += 3;
+  } else
+    for (; w < p->width; w++)
+      buf[o++] = ' ';
+  free(p->next[r]);
+  p->next[r] = malloc(o + 1);
+  if (p->next[r]) {
+    memcpy(p->next[r], buf, o);
+    p->next[r][o] = '\0';
+  }
+}
+
+/* кадр меню (в fbuf, как для полного экрана) + превью секции sec_idx */
+static void split_draw(int cols, int sec_idx) {
+  static char *menu = NULL;
+  static size_t menu_cap = 0;
+  size_t mlen = fbuf_len;
+  if (mlen + 1 > menu_cap) {
+    char *tmp = realloc(menu, mlen + 1);
+    if (!tmp)
+      return;
+    menu = tmp;
+    menu_cap = mlen + 1;
+  }
+  memcpy(menu, fbuf, mlen);
+  fb_reset();
+
+  /* панель меню — по самой широкой строке: баннеры у шпаргалок разные */
+  char scratch[SPLIT_LINE];
+  int left = 0;
+  for (const char *m = menu, *end = menu + mlen; m < end;) {
+    const char *nl = memchr(m, '\n', (size_t)(end - m));
+    size_t n = nl ? (size_t)(nl - m) : (size_t)(end - m);
+    int w;
+    split_fit(m, n, cols, scratch, sizeof(scratch), NULL, &w);
+    left = w + 2 > left ? w + 2 : left;
+    m += n + 1;
+  }
+  left = left < cols / 2 ? left : cols / 2;
+
+  int rows = term_rows();
+  if (rows != split_h || cols != split_w || left != split_left) {
+    split_reset();
+    for (int p = 0; p < 2; p++) {
+      split_pane[p].shown = calloc((size_t)rows, sizeof(char *));
+      split_pane[p].next = calloc((size_t)rows, sizeof(char *));
+    }
+    if (!split_pane[0].next || !split_pane[1].next) {
+      split_reset();
+      return;
+    }
+    split_h = rows;
+    split_w = cols;
+    split_left = left;
+  }
+  /* последняя колонка — пустая: запись в неё переводит строку */
+  split_pane[0] =
+      (SplitPane){1, left, 0, split_pane[0].shown, split_pane[0].next};
+  split_pane[1] = (SplitPane){left + 1, cols - left - 3, 1,
+                              split_pane[1].shown, split_pane[1].next};
+
+  unsigned gen = atomic_load(&spec_gen);
+  if (!split_have || split_sec != sec_idx || split_gen != gen) {
+    const char **sec = sec_idx == SEC_RECENT ? recent_sec : sec_lines(sec_idx);
+    if (render_section(sec_idx))
+      flat_open(&split_flat, sec, sec_idx);
+    else {
+      tv_flat_free(&split_flat);
+      tv_flat_build(&split_flat, tutor, sec);
+    }
+    split_sec = sec_idx;
+    split_gen = gen;
+    split_have = 1;
+  }
+
+  char carry[64] = "";
+  const char *m = menu, *end = menu + mlen;
+  for (int r = 0; r < rows; r++) {
+    const char *nl = m < end ? memchr(m, '\n', (size_t)(end - m)) : NULL;
+    size_t n = m < end ? (nl ? (size_t)(nl - m) : (size_t)(end - m)) : 0;
+    split_row(&split_pane[0], r, "", m, n, carry);
+    m = nl ? nl + 1 : end;
+  }
+  for (int r = 0; r < rows; r++) {
+    const char *t = r < split_flat.n ? split_flat.v[r].text : "";
+    split_row(&split_pane[1], r, SPLIT_BAR, t, strlen(t), NULL);
+  }
+
+  for (int p = 0; p < 2; p++)
+    for (int r = 0; r < rows; r++) {
+      SplitPane *sp = &split_pane[p];
+      if (!sp->next[r] || (sp->shown[r] && !strcmp(sp->shown[r], sp->next[r])))
+        continue;
+      fb_appendf("\033[%d;%dH", r + 1, sp->col);
+      fb_append(sp->next[r]);
+    }
+  int shown = fb_present();
+  for (int p = 0; p < 2; p++)
+    for (int r = 0; r < rows; r++) {
+      SplitPane *sp = &split_pane[p];
+      if (shown && sp->next[r]) { /* выброшенный кадр — экран прежний */
+        free(sp->shown[r]);
+        sp->shown[r] = sp->next[r];
+      } else
+        free(sp->next[r]);
+      sp->next[r] = NULL;
+    }
+}
+
+/* «Недавние», если есть, — пункт 0 над секциями */
+static int menu_items(void) { return nsections + (recent_n > 0); }
+
+/* пункт меню → индекс секции или SEC_RECENT, и обратно (-1 — нет такого) */
+static int menu_sec(int cur) {
+  return recent_n > 0 && cur == 0 ? SEC_RECENT : cur - (recent_n > 0);
+}
+
+static int menu_item(int sec) {
+  if (sec == SEC_RECENT)
+    return recent_n > 0 ? 0 : -1;
+  return sec >= 0 ? sec + (recent_n > 0) : -1;
+}
+
+/* пункт под курсором: чего нет в RENDER CACHE, строится заранее */
+static void menu_hover(int cur) {
+  int s = menu_sec(cur);
+  if (s == SEC_RECENT)
+    spec_request(recent_sec);
+  else if (!render_valid)
+    spec_request(sec_lines(s));
+}
+
+static void menu_open(int cur) {
+  int s = menu_sec(cur);
+  split_reset(); /* экран займёт секция */
+  view_section(s == SEC_RECENT ? recent_sec : sec_lines(s), s);
+}
+
+/* кадр меню собран в fbuf: на весь экран или в SPLIT PANE */
+static void menu_present(int cur) {
+  int cols = term_cols();
+  if (cols >= SPLIT_MIN)
+    split_draw(cols, menu_sec(cur));
+  else {
+    if (split_h) /* был широкий экран */
+      split_reset();
+    fb_present();
+  }
+}
+
+static void print_menu(int cur) {
+  static TutorView v;
+  static const char **items = NULL;
+  static int items_cap = 0;
+  const MenuFrame *m = &menu_frame[tutor_idx];
+  int off = recent_n > 0;
+
+  fb_reset();
+  if (!content_external && !off && nsections == m->n && cur >= 0 &&
+      cur < m->n) {
+    fb_appendn(m->frame, m->at[2 * cur]);
+    fb_appendn(m->cur + m->cur_at[cur], m->cur_at[cur + 1] - m->cur_at[cur]);
+    fb_appendn(m->frame + m->at[2 * cur + 1], m->len - m->at[2 * cur + 1]);
+    menu_present(cur);
+    return;
+  }
+
+  if (nsections + 1 > items_cap) {
+    const char **tmp = realloc(items, sizeof(*items) * (size_t)(nsections + 1));
+    if (!tmp)
+      return;
+    items = tmp;
+    items_cap = nsections + 1;
+  }
+  if (off)
+    items[0] = recent_label;
+  for (int i = 0; i < nsections; i++)
+    items[i + off] = sections[i].label;
+
+  char hint[256];
+  menu_hint(tutor_idx, hint, sizeof(hint));
+  if (v.tutor != tutor) { /* Tab — другая шпаргалка */
+    tv_free(&v);
+    tv_init(&v, tutor, view_sink, NULL);
+  }
+  tv_menu(&v, items, nsections + off, off, cur, hint);
+  menu_present(cur);
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   RECENT
+   Frecency: сумма весов событий строки × множитель давности последнего.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define HIST_SLOTS 2048 /* открытая адресация, степень двойки */
+
+typedef struct {
+  uint32_t hash, ts, weight;
+  uint16_t sec, line;
+} HistRow;
+
+static HistRow *hist_rows = NULL; /* HIST_SLOTS, hash == 0 — пусто */
+static size_t hist_nrecs = 0;
+static time_t hist_now; /* один на всю сортировку: порядок согласован */
+
+static double hist_recency(uint32_t ts, time_t now) {
+  double age = (double)(now - (time_t)ts);
+  if (age < 3600)
+    return 4.0;
+  if (age < 86400)
+    return 2.0;
+  if (age < 7 * 86400)
+    return 1.0;
+  if (age < 30 * 86400)
+    return 0.5;
+  return 0.25;
+}
+
+static double hist_score(const HistRow *r, time_t now) {
+  return r->weight * hist_recency(r->ts, now);
+}
+
+static int hist_row_cmp(const void *a, const void *b) {
+  double x = hist_score(a, hist_now), y = hist_score(b, hist_now);
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/* hash → текущее положение строки; подсказку из лога проверяем первой */
+static int hist_resolve(HistRow *r) {
+  if (r->sec < nsections) {
+    const char **sec = sec_lines(r->sec);
+    int i = 0;
+    while (sec[i] && i < r->line)
+      i++;
+    if (sec[i] && sec[i][0] == 'R' && row_hash(sec[i]) == r->hash)
+      return 1;
+  }
+  for (int s = 0; s < nsections; s++) {
+    const char **sec = sec_lines(s);
+    for (int i = 0; sec[i]; i++)
+      if (sec[i][0] == 'R' && row_hash(sec[i]) == r->hash) {
+        r->sec = (uint16_t)s;
+        r->line = (uint16_t)i;
+        return 1;
+      }
+  }
+  return 0;
+}
+
+/* переписать лог одной записью на строку: tmp + rename, чтобы
+   параллельный tutor не увидел половину файла. in — прочитанный
+   hist_load лог; LOCK_EX на нём держит писателей (hist_event, LOCK_SH)
+   от хвоста до rename, после чего они переоткрывают лог по st_nlink */
+static void hist_compact(int in) {
+  if (hist_nrecs < HIST_COMPACT_AT || !hist_rows)
+    return;
+  char path[1024], tmp[1100];
+  if (tutor_path("XDG_STATE_HOME", ".local/state", ".log", path,
+               sizeof(path)) != 0)
+    return;
+  struct stat st;
+  if (flock(in, LOCK_EX) != 0)
+    return;
+  if (fstat(in, &st) != 0 || st.st_nlink == 0) {
+    flock(in, LOCK_UN); /* нас опередил другой tutor */
+    return;
+  }
+  snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    flock(in, LOCK_UN);
+    return;
+  }
+
+  HistRec out[256];
+  size_t n = 0, ok = 1;
+  for (size_t i = 0; i < HIST_KEEP && hist_rows[i].hash; i++) {
+    const HistRow *r = &hist_rows[i];
+    out[n++] = (HistRec){r->hash, r->ts, r->sec, r->line,
+                         (uint16_t)(r->weight > 0xffff ? 0xffff : r->weight),
+                         HIST_MERGED, 0};
+    if (n == sizeof(out) / sizeof(out[0]) || i + 1 == HIST_KEEP ||
+        !hist_rows[i + 1].hash) {
+      ok &= write(fd, out, n * sizeof(HistRec)) == (ssize_t)(n * sizeof(HistRec));
+      n = 0;
+    }
+  }
+
+  /* что другие tutor'ы дописали, пока мы читали, — как есть, в хвост */
+  off_t seen = (off_t)(hist_nrecs * sizeof(HistRec));
+  if (lseek(in, seen, SEEK_SET) == seen) {
+    ssize_t r;
+    while (ok && (r = read(in, out, sizeof(out))) > 0)
+      ok &= write(fd, out, (size_t)r) == r;
+  } else {
+    ok = 0;
+  }
+  close(fd);
+  if (!ok || rename(tmp, path) != 0)
+    unlink(tmp);
+  flock(in, LOCK_UN);
+}
+
+static void hist_load(void) {
+  char path[1024];
+  if (tutor_path("XDG_STATE_HOME", ".local/state", ".log", path,
+               sizeof(path)) != 0)
+    return;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(HistRec)) {
+    close(fd);
+    return;
+  }
+  const HistRec *log =
+      mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (log == MAP_FAILED) {
+    close(fd);
+    return;
+  }
+
+  hist_nrecs = (size_t)st.st_size / sizeof(HistRec);
+  hist_rows = calloc(HIST_SLOTS, sizeof(HistRow));
+  static const uint32_t kind_weight[] = {0, 1, 3, 1};
+  for (size_t i = 0; hist_rows && i < hist_nrecs; i++) {
+    const HistRec *e = &log[i];
+    if (!e->hash || e->kind < HIST_DWELL || e->kind > HIST_MERGED)
+      continue;
+    size_t h = e->hash & (HIST_SLOTS - 1);
+    size_t probes = 0;
+    while (hist_rows[h].hash && hist_rows[h].hash != e->hash &&
+           ++probes < HIST_SLOTS)
+      h = (h + 1) & (HIST_SLOTS - 1);
+    if (probes == HIST_SLOTS)
+      break;
+    HistRow *r = &hist_rows[h];
+    r->hash = e->hash;
+    r->weight += kind_weight[e->kind] * e->count;
+    if (e->ts >= r->ts) { /* подсказка — из последнего события */
+      r->ts = e->ts;
+      r->sec = e->sec;
+      r->line = e->line;
+    }
+  }
+  munmap((void *)log, (size_t)st.st_size);
+  if (!hist_rows) {
+    close(fd);
+    return;
+  }
+
+  /* непустые слоты в начало, по убыванию frecency */
+  size_t n = 0;
+  for (size_t i = 0; i < HIST_SLOTS; i++)
+    if (hist_rows[i].hash)
+      hist_rows[n++] = hist_rows[i];
+  memset(hist_rows + n, 0, (HIST_SLOTS - n) * sizeof(HistRow));
+  hist_now = time(NULL);
+  qsort(hist_rows, n, sizeof(HistRow), hist_row_cmp);
+  hist_compact(fd);
+  close(fd);
+
+  recent_sec[recent_n++] = "T:НЕДАВНИЕ";
+  size_t ln = (size_t)snprintf(recent_label, sizeof(recent_label), "Недавние");
+  for (size_t i = 0; i < n && recent_n <= HIST_TOP; i++) {
+    if (!hist_resolve(&hist_rows[i]))
+      continue;
+    const char *line = sec_lines(hist_rows[i].sec)[hist_rows[i].line];
+    recent_src[recent_n] = ((uint32_t)hist_rows[i].sec << 16) | hist_rows[i].line;
+    recent_sec[recent_n++] = line;
+    if (recent_n <= 4 && ln < sizeof(recent_label))
+      ln += (size_t)snprintf(recent_label + ln, sizeof(recent_label) - ln,
+                             "%s%.*s", recent_n == 2 ? "  (" : " / ",
+                             (int)strcspn(line + 2, "|"), line + 2);
+  }
+  if (recent_n > 1 && ln < sizeof(recent_label))
+    snprintf(recent_label + ln, sizeof(recent_label) - ln, ")");
+  if (recent_n == 1)
+    recent_n = 0; /* в логе только исчезнувшие строки */
+  recent_sec[recent_n] = NULL;
+}
+
+/* уход со шпаргалки (Tab, выход): «Недавние» сбрасываются */
+static void hist_close(void) {
+  free(hist_rows);
+  hist_rows = NULL;
+  hist_nrecs = 0;
+  recent_n = 0;
+  if (hist_fd >= 0)
+    close(hist_fd);
+  hist_fd = -1;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   QUERY MODE
+   -q: совпадающие строки всех секций в stdout. termios и alternate
+   screen не трогаем, весь вывод — один write().
+   ══════════════════════════════════════════════════════════════════════ */
+
+/* строка подходит, если в ней есть каждое слово запроса (И) */
+static int query_match(const char *hay, char *const *words, int nwords) {
+  for (int i = 0; i < nwords; i++)
+    if (!strstr(hay, words[i]))
+      return 0;
+  return 1;
+}
+
+static int query_print(const char *query) {
+  char q[512], plain[512], hay[2048], buf[512];
+  char *words[64];
+  int nwords = 0;
+  tv_fold(query, q, sizeof(q), 0);
+  for (char *p = q; *p && nwords < (int)(sizeof(words) / sizeof(words[0]));) {
+    p += strspn(p, " \t");
+    if (!*p)
+      break;
+    words[nwords++] = p;
+    p += strcspn(p, " \t");
+    if (*p)
+      *p++ = '\0';
+  }
+  int tty = isatty(STDOUT_FILENO);
+  int found = 0;
+
+  for (int s = 0; s < nsections; s++) {
+    int shown = 0;
+    for (const char **l = sec_lines(s); *l; l++) {
+      const char *line = *l;
+      if (line[0] != 'R' && line[0] != 'C' && line[0] != 'N')
+        continue;
+
+      /* индексируем "key desc", как видно на экране */
+      snprintf(plain, sizeof(plain), "%s", line + 2);
+      char *pipe = strchr(plain, '|');
+      if (line[0] == 'R' && pipe)
+        *pipe = ' ';
+      tv_srch_build(plain, hay, sizeof(hay));
+      if (!query_match(hay, words, nwords))
+        continue;
+      found = 1;
+
+      if (tty) {
+        if (!shown)
+          fb_appendf(C_HEAD BOLD "  ## %s" RESET "\n", sections[s].label);
+        tv_row_render(tutor, line, buf, sizeof(buf));
+        fb_append(buf);
+        fb_append("\n");
+      } else {
+        if (pipe)
+          *pipe = '\t';
+        fb_append(plain);
+        fb_append(line[0] == 'R' && pipe ? "\t" : "\t\t");
+        fb_append(sections[s].id);
+        fb_append("\n");
+      }
+      shown = 1;
+    }
+  }
+
+  fb_flush();
+  return found ? 0 : 1;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   FILTER
+   -w слово: R:/C:/N:-строки всех секций, где на экране есть слово, —
+   одной псевдо-секцией в просмотрщике; q возвращает прямо в шелл.
+   Так её открывает виджет zsh (tutor-widget в zsh/functions.zsh) со
+   словом под курсором ZLE, поэтому запуск короткий: при живом RENDER
+   CACHE попадания ищутся по его готовым индексам и разворачиваются
+   только секции, где они есть; меню, «Недавние», SESSION, inotify и
+   демон не трогаются, stdio — только для ошибок.
+   ══════════════════════════════════════════════════════════════════════ */
+
+/* есть ли q в строках секции на экране: 1/0, -1 — кэш не знает */
+static int filter_cached(int s, const char *q) {
+  const RenderSection *r = render_section(s);
+  if (!r)
+    return -1;
+  const RenderHeader *h = (const RenderHeader *)render_map;
+  const RenderLine *rl =
+      (const RenderLine *)((const RenderSection *)(h + 1) + h->nsec);
+  const char *heap = (const char *)(rl + h->nlines);
+  for (uint32_t i = r->first; i < r->first + r->n; i++)
+    if (strstr(heap + rl[i].srch, q))
+      return 1;
+  return 0;
+}
+
+static int filter_push(const char *line, uint32_t src, int *n, int *cap) {
+  if (*n + 2 > *cap) {
+    int nc = *cap ? *cap * 2 : 64;
+    const char **ls = realloc(filter_sec, sizeof(*ls) * (size_t)nc);
+    if (ls)
+      filter_sec = ls;
+    uint32_t *ss = realloc(filter_src, sizeof(*ss) * (size_t)nc);
+    if (ss)
+      filter_src = ss;
+    if (!ls || !ss)
+      return -1;
+    *cap = nc;
+  }
+  filter_src[*n] = src;
+  filter_sec[(*n)++] = line;
+  filter_sec[*n] = NULL;
+  return 0;
+}
+
+static int filter_view(const char *word) {
+  char q[512], title[600], buf[512], hay[2048];
+  char *heads[SECTIONS_MAX]; /* "G:<подпись секции>" */
+  int n = 0, cap = 0, nh = 0, rc = 1;
+  tv_fold(word, q, sizeof(q), 0);
+  snprintf(title, sizeof(title), "T:%s", word);
+  if (filter_push(title, 0, &n, &cap) != 0)
+    return 1;
+
+  render_attach();
+  for (int s = 0; s < nsections; s++) {
+    if (!q[0] || !filter_cached(s, q))
+      continue; /* секцию даже не распаковываем */
+    const char **lines = sec_lines(s);
+    int shown = 0;
+    for (int i = 0; lines[i]; i++) {
+      const char *line = lines[i];
+      if (line[0] != 'R' && line[0] != 'C' && line[0] != 'N')
+        continue;
+      /* тот же индекс, что у строки экрана в кэше и в поиске / */
+      tv_row_render(tutor, line, buf, sizeof(buf));
+      buf[tv_ansi_strip(buf, strlen(buf), buf)] = '\0';
+      tv_srch_build(buf, hay, sizeof(hay));
+      if (!strstr(hay, q))
+        continue;
+      if (!shown) {
+        size_t len = strlen(sections[s].label) + 3;
+        if (!(heads[nh] = malloc(len)))
+          goto out;
+        snprintf(heads[nh], len, "G:%s", sections[s].label);
+        if (filter_push(heads[nh++], 0, &n, &cap) != 0)
+          goto out;
+      }
+      if (filter_push(line, (uint32_t)s << 16 | (uint32_t)i, &n, &cap) != 0)
+        goto out;
+      shown = 1;
+    }
+  }
+
+  if (nh > 0) {
+    term_open();
+    atexit(term_restore);
+    view_section(filter_sec, SEC_FILTER);
+    term_close();
+    rc = 0;
+  }
+out:
+  for (int i = 0; i < nh; i++)
+    free(heads[i]);
+  free(filter_sec);
+  free(filter_src);
+  filter_sec = NULL;
+  filter_src = NULL;
+  return rc;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   EXPORT
+   -e text — секции как на экране, без цвета (ANSI вырезается из TvLine)
+   -e json — JSON Lines: section / title / group / kind / key / desc / row
+   -e nul  — section<TAB>group<TAB>row<TAB>key<NUL>, для fzf --read0
+   Вывод копится во fbuf и уходит кусками по 64 КБ.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define EXPORT_CHUNK (64 * 1024)
+
+static void fb_json(const char *s, size_t n) {
+  fb_append("\"");
+  for (size_t i = 0; i < n; i++) {
+    unsigned char c = (unsigned char)s[i];
+    if (c == '"' || c == '\\') {
+      char esc[2] = {'\\', (char)c};
+      fb_appendn(esc, 2);
+    } else if (c < 0x20) {
+      fb_appendf("\\u%04x", c);
+    } else {
+      size_t j = i;
+      while (j < n && (unsigned char)s[j] >= 0x20 && s[j] != '"' &&
+             s[j] != '\\')
+        j++;
+      fb_appendn(s + i, j - i);
+      i = j - 1;
+    }
+  }
+  fb_append("\"");
+}
+
+static void export_text(void) {
+  char plain[512];
+  TvFlat f = {0};
+  for (int s = 0; s < nsections; s++) {
+    tv_flat_build(&f, tutor, sec_lines(s));
+    for (int i = 0; i < f.n; i++) {
+      size_t n = tv_ansi_strip(f.v[i].text, strlen(f.v[i].text), plain);
+      fb_appendn(plain, n);
+      fb_append("\n");
+    }
+    fb_append("\n");
+    if (fbuf_len >= EXPORT_CHUNK)
+      fb_flush();
+  }
+  tv_flat_release(&f);
+}
+
+static void export_rows(int json) {
+  char row[512];
+  for (int s = 0; s < nsections; s++) {
+    const char *title = "", *group = "";
+    for (const char **l = sec_lines(s); *l; l++) {
+      const char *line = *l;
+      const char *content = line + 2;
+      if (line[0] == 'T')
+        title = content;
+      if (line[0] == 'G')
+        group = content;
+      if (line[0] != 'R' && line[0] != 'C' && line[0] != 'N')
+        continue;
+
+      const char *pipe = line[0] == 'R' ? strchr(content, '|') : NULL;
+      size_t klen = line[0] != 'R' ? 0 : pipe ? (size_t)(pipe - content)
+                                              : strlen(content);
+      const char *desc = pipe ? pipe + 1 : line[0] == 'R' ? "" : content;
+      tv_row_render(tutor, line, row, sizeof(row));
+      size_t rlen = tv_ansi_strip(row, strlen(row), row);
+
+      if (json) {
+        fb_append("{\"section\":");
+        fb_json(sections[s].id, strlen(sections[s].id));
+        fb_append(",\"title\":");
+        fb_json(title, strlen(title));
+        fb_append(",\"group\":");
+        fb_json(group, strlen(group));
+        fb_append(line[0] == 'R'   ? ",\"kind\":\"row\",\"key\":"
+                  : line[0] == 'C' ? ",\"kind\":\"code\",\"key\":"
+                                   : ",\"kind\":\"note\",\"key\":");
+        fb_json(content, klen);
+        fb_append(",\"desc\":");
+        fb_json(desc, strlen(desc));
+        fb_append(",\"row\":");
+        fb_json(row, rlen);
+        fb_append("}\n");
+      } else {
+        fb_append(sections[s].id);
+        fb_append("\t");
+        fb_append(group);
+        fb_append("\t");
+        fb_appendn(row, rlen);
+        fb_append("\t");
+        fb_appendn(content, klen);
+        fb_appendn("", 1); /* NUL-разделитель записей */
+      }
+      if (fbuf_len >= EXPORT_CHUNK)
+        fb_flush();
+    }
+  }
+}
+
+static int export_print(const char *fmt) {
+  if (!strcmp(fmt, "text"))
+    export_text();
+  else if (!strcmp(fmt, "json"))
+    export_rows(1);
+  else if (!strcmp(fmt, "nul"))
+    export_rows(0);
+  else {
+    fprintf(stderr, "%s: неизвестный формат '%s' (text/json/nul)\n",
+            tutor->name, fmt);
+    return 2;
+  }
+  fb_flush();
+  return 0;
+}
+
+/* ══════════════════════════════════════════════════════════════════════
+   DAEMON
+   tutor --daemon: по процессу-«зиготе» на шпаргалку. Зигота один раз
+   грузит контент, распаковывает секции, держит RENDER CACHE и слушает
+   $XDG_RUNTIME_DIR/tutor/<tutor>.sock. Обычный интерактивный запуск
+   сначала стучится туда: передаёт свой tty через SCM_RIGHTS и ждёт.
+   Зигота форкается, ребёнок делает tty своими stdin/stdout и идёт в
+   обычный main — всё уже в памяти (copy-on-write), так что от хоткея
+   до первого кадра — fork и один write. Терминалов сколько угодно:
+   у каждого свой ребёнок. Правки контента зигота ловит через inotify.
+   Потоков в зиготе нет, иначе fork был бы небезопасен.
+   ══════════════════════════════════════════════════════════════════════ */
+
+#define DAEMON_MAGIC "TUTHELO"
+
+typedef struct {
+  char magic[8];
+  char sec[64];    /* -s клиента, "" — без него */
+  int64_t boot_ns; /* его execve — для TUTOR_STARTUP_LOG */
+  char term[96];   /* его TERM/TERM_PROGRAM — ключ TERMINAL PROBE */
+} DaemonHello;
+
+static char daemon_sec[64]; /* -s, пришедший в ребёнка зиготы */
+static pid_t daemon_child = 0;
+
+static int daemon_addr(struct sockaddr_un *sa) {
+  char path[1024];
+  if (tutor_path("XDG_RUNTIME_DIR", ".cache", ".sock", path, sizeof(path)) !=
+          0 ||
+      strlen(path) >= sizeof(sa->sun_path))
+    return -1;
+  memset(sa, 0, sizeof(*sa));
+  sa->sun_family = AF_UNIX;
+  memcpy(sa->sun_path, path, strlen(path) + 1);
+  return 0;
+}
+
+static void daemon_forward(int sig) {
+  if (daemon_child > 0)
+    kill(daemon_child, sig);
+}
+
+/* клиент: отдать tty демону и дождаться конца. -1 — демона нет */
+static int daemon_connect(const char *sec_id) {
+  struct sockaddr_un sa;
+  if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO) || daemon_addr(&sa))
+    return -1;
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+    close(fd);
+    return -1;
+  }
+  DaemonHello hello = {DAEMON_MAGIC, "", boot_ns, ""};
+  snprintf(hello.sec, sizeof(hello.sec), "%s", sec_id ? sec_id : "");
+  snprintf(hello.term, sizeof(hello.term), "%s", term_key());
+  union {
+    struct cmsghdr h;
+    char buf[CMSG_SPACE(sizeof(int))];
+  } ctl;
+  struct iovec iov = {&hello, sizeof(hello)};
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctl.buf;
+  msg.msg_controllen = sizeof(ctl.buf);
+  struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(sizeof(int));
+  int tty = STDIN_FILENO;
+  memcpy(CMSG_DATA(c), &tty, sizeof(int));
+
+  int32_t pid = 0;
+  struct termios saved;
+  int have_saved = tcgetattr(STDIN_FILENO, &saved) == 0;
+  if (sendmsg(fd, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(hello) ||
+      read(fd, &pid, sizeof(pid)) != (ssize_t)sizeof(pid) || pid <= 0) {
+    close(fd); /* демон есть, но не ответил — справимся сами */
+    return -1;
+  }
+
+  /* Ctrl-C и закрытие терминала приходят нам, а не ребёнку демона */
+  daemon_child = (pid_t)pid;
+  struct sigaction sa_fwd;
+  memset(&sa_fwd, 0, sizeof(sa_fwd));
+  sa_fwd.sa_handler = daemon_forward;
+  sigemptyset(&sa_fwd.sa_mask);
+  sigaction(SIGINT, &sa_fwd, NULL);
+  sigaction(SIGTERM, &sa_fwd, NULL);
+  sigaction(SIGHUP, &sa_fwd, NULL);
+
+  char b;
+  ssize_t r;
+  while ((r = read(fd, &b, 1)) > 0 || (r < 0 && errno == EINTR))
+    ; /* EOF — ребёнок вышел */
+  close(fd);
+  if (have_saved) /* на случай, если он упал, не вернув терминал */
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+  return 0;
+}
+
+/* контент и RENDER CACHE зиготы в актуальном виде */
+static void daemon_warm(void) {
+  for (int s = 0; s < nsections; s++)
+    sec_lines(s);
+  if (!render_valid)
+    render_load();
+  render_save();
+}
+
+/* принять клиента; в ребёнке → 1 (идти в интерактивный main) */
+static int daemon_accept(int lfd) {
+  int fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+  if (fd < 0)
+    return 0;
+  DaemonHello hello;
+  union {
+    struct cmsghdr h;
+    char buf[CMSG_SPACE(sizeof(int))];
+  } ctl;
+  struct iovec iov = {&hello, sizeof(hello)};
+  struct msghdr msg = {0};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctl.buf;
+  msg.msg_controllen = sizeof(ctl.buf);
+  int tty = -1;
+  if (recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) == (ssize_t)sizeof(hello)) {
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    if (c && c->cmsg_type == SCM_RIGHTS &&
+        c->cmsg_len == CMSG_LEN(sizeof(int)))
+      memcpy(&tty, CMSG_DATA(c), sizeof(int));
+  }
+  if (tty < 0 || memcmp(hello.magic, DAEMON_MAGIC, 8) || !isatty(tty)) {
+    if (tty >= 0)
+      close(tty);
+    close(fd);
+    return 0;
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    /* fd клиента остаётся открытым до нашего выхода: его EOF — сигнал
+       клиенту; CLOEXEC — чтобы не держали дети DETAIL PAGES */
+    close(lfd);
+    signal(SIGCHLD, SIG_DFL);
+    dup2(tty, STDIN_FILENO);
+    dup2(tty, STDOUT_FILENO);
+    close(tty);
+    content_unwatch(); /* inotify зиготы — её, свой заведём в main */
+    hello.sec[sizeof(hello.sec) - 1] = '\0';
+    memcpy(daemon_sec, hello.sec, sizeof(daemon_sec));
+    boot_ns = hello.boot_ns; /* CLOCK_MONOTONIC общий на всю систему */
+    hello.term[sizeof(hello.term) - 1] = '\0';
+    memcpy(term_id, hello.term, sizeof(term_id));
+    boot_byte_ns = 0;
+    return 1;
+  }
+  int32_t p = pid > 0 ? (int32_t)pid : -1;
+  ssize_t w = write(fd, &p, sizeof(p));
+  (void)w;
+  close(tty);
+  close(fd);
+  return 0;
+}
+
+/* зигота текущей шпаргалки: в ребёнке → 1, иначе не возвращается */
+static int daemon_zygote(void) {
+  struct sockaddr_un sa;
+  if (daemon_addr(&sa) != 0) {
+    fprintf(stderr, "%s: нет пути для сокета\n", tutor->name);
+    _exit(1);
+  }
+  mkdir_parents(sa.sun_path);
+  unlink(sa.sun_path);
+  int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  mode_t um = umask(077);
+  int ok = lfd >= 0 && bind(lfd, (struct sockaddr *)&sa, sizeof(sa)) == 0 &&
+           listen(lfd, 16) == 0;
+  umask(um);
+  if (!ok) {
+    fprintf(stderr, "%s: %s: %s\n", tutor->name, sa.sun_path,
+            strerror(errno));
+    _exit(1);
+  }
+
+  /* демон живёт долго: каталог контента заводим заранее, чтобы
+     inotify было за чем следить, даже если --init-content ещё не было */
+  char dir[1024];
+  if (tutor_path("XDG_DATA_HOME", ".local/share", "", dir, sizeof(dir)) == 0)
+    mkdir_parents(dir);
+  content_load(1);
+  render_load();
+  daemon_warm();
+  content_watch();
+  signal(SIGCHLD, SIG_IGN); /* детей-клиентов не ждём */
+
+  while (1) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(lfd, &fds);
+    if (watch_fd >= 0)
+      FD_SET(watch_fd, &fds);
+    int nfds = (watch_fd > lfd ? watch_fd : lfd) + 1;
+    if (select(nfds, &fds, NULL, NULL, NULL) <= 0)
+      continue;
+    if (watch_fd >= 0 && FD_ISSET(watch_fd, &fds)) {
+      content_reload();
+      daemon_warm();
+    }
+    if (FD_ISSET(lfd, &fds) && daemon_accept(lfd))
+      return 1;
+  }
+}
+
+/* --daemon: по зиготе на шпаргалку, сами ждём их. -1 — мы ребёнок
+   зиготы, дальше обычный интерактивный запуск */
+static int daemon_run(void) {
+  pid_t pids[TUTORS_N];
+  for (int i = 0; i < TUTORS_N; i++) {
+    if ((pids[i] = fork()) == 0) {
+      prctl(PR_SET_PDEATHSIG, SIGTERM); /* умер демон — умерли зиготы */
+      tutor_select(i);
+      daemon_zygote();
+      return -1;
+    }
+  }
+  int status = 0;
+  for (int i = 0; i < TUTORS_N; i++)
+    if (pids[i] > 0 && waitpid(pids[i], &status, 0) > 0 &&
+        (!WIFEXITED(status) || WEXITSTATUS(status)))
+      status = 1;
+  return status ? 1 : 0;
+}
+
+static void usage(FILE *f) {
+  fprintf(f,
+          "usage: %s [-t git|zsh|nvim] [-s секция] [-k ключ] [-q слово...]"
+          " [-e формат]\n"
+          "       %s -w слово\n"
+          "       %s -f файл\n"
+          "       %s --zsh-completion | --init-content | --pack | --daemon\n"
+          "  -t git|zsh|nvim    шпаргалка (по умолчанию — по имени бинаря:\n"
+          "                     gitutor, zshtutor, nvimtutor)\n"
+          "  -s секция          открыть секцию сразу\n"
+          "  -k ключ            R:-строки с этим ключом или префиксом\n"
+          "  -q слово...        найти строки со всеми словами и выйти\n"
+          "  -w слово           открыть только строки со словом (виджет zsh)\n"
+          "  -e text|json|nul   выгрузить все секции в stdout\n"
+          "  -f файл            открыть любой текст (хоть 50 МБ)\n"
+          "  --zsh-completion   функция дополнения для zsh\n"
+          "  --init-content     выгрузить секции в $XDG_DATA_HOME/tutor/%s/\n"
+          "                     для правки; файлы оттуда заменяют встроенные\n"
+          "  --pack             собрать их в %s.pack — без разбора текста\n"
+          "                     при каждом запуске\n"
+          "  --daemon           держать шпаргалки в памяти; обычный запуск\n"
+          "                     отдаёт ему терминал и открывается мгновенно\n",
+          tutor->name, tutor->name, tutor->name, tutor->name, tutor->name,
+          tutor->name);
+}
+
+static int section_by_id(const char *id) {
+  for (int i = 0; i < nsections; i++)
+    if (!strcmp(sections[i].id, id))
+      return i;
+  return -1;
+}
+
+/* Tab в меню: следующая шпаргалка целиком — контент, история, inotify */
+static void tutor_switch(int i) {
+  spec_quiesce();
+  hist_close();
+  render_save();
+  state_close();
+  content_unwatch();
+  tutor_select(i);
+  content_load(1);
+  render_load();
+  hist_load();
+  state_open();
+  content_watch();
+}
+
+int main(int argc, char **argv) {
+  static const struct option longopts[] = {
+      {"zsh-completion", no_argument, NULL, 'Z'},
+      {"export", required_argument, NULL, 'e'},
+      {"file", required_argument, NULL, 'f'},
+      {"init-content", no_argument, NULL, 'I'},
+      {"pack", no_argument, NULL, 'P'},
+      {"daemon", no_argument, NULL, 'D'},
+      {"word", required_argument, NULL, 'w'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  const char *query = NULL, *sec_id = NULL, *word = NULL, *arg = NULL;
+  int opt, act = 0;
+  int t = tutor_find(argv[0]);
+  tutor_select(t >= 0 ? t : 0);
+  /* действие выполняется после разбора: -t может стоять где угодно,
+     а грузится только выбранная шпаргалка */
+  while ((opt = getopt_long(argc, argv, "e:f:k:q:s:t:w:h", longopts, NULL)) !=
+         -1) {
+    switch (opt) {
+    case 't':
+      if ((t = tutor_find(optarg)) < 0) {
+        fprintf(stderr, "%s: нет шпаргалки '%s' (git/zsh/nvim)\n",
+                tutor->name, optarg);
+        return 2;
+      }
+      tutor_select(t);
+      break;
+    case 'q':
+      query = optarg;
+      break;
+    case 's':
+      sec_id = optarg;
+      break;
+    case 'w':
+      word = optarg;
+      break;
+    case 'e':
+    case 'f':
+    case 'k':
+    case 'Z':
+    case 'I':
+    case 'P':
+    case 'D':
+      act = opt;
+      arg = optarg;
+      break;
+    case 'h':
+      usage(stdout);
+      return 0;
+    default:
+      usage(stderr);
+      return 2;
+    }
+  }
+
+  switch (act) {
+  case 'Z':
+    return zsh_completion();
+  case 'I':
+    return content_init();
+  case 'P':
+    content_load(0);
+    return pack_write();
+  case 'f':
+    return doc_view(arg);
+  case 'D':
+    if ((t = daemon_run()) >= 0)
+      return t;
+    /* ребёнок зиготы: контент и RENDER CACHE уже в памяти */
+    sec_id = daemon_sec[0] ? daemon_sec : NULL;
+    break;
+  case 0:
+    if (!query && !word && daemon_connect(sec_id) == 0)
+      return 0;
+    break;
+  }
+  if (act != 'D')
+    content_load(1);
+  if (act == 'e')
+    return export_print(arg);
+  if (act == 'k')
+    return keys_print(arg);
+
+  int open_sec = sec_id ? section_by_id(sec_id) : -1;
+  if (sec_id && open_sec < 0) {
+    fprintf(stderr, "%s: нет секции '%s'\n", tutor->name, sec_id);
+    return 2;
+  }
+
+  if (query) {
+    /* "-q rebase abort": слова ищутся по отдельности, все сразу */
+    char q[512];
+    int n = snprintf(q, sizeof(q), "%s", query);
+    for (int i = optind; i < argc && n < (int)sizeof(q); i++)
+      n += snprintf(q + n, sizeof(q) - (size_t)n, " %s", argv[i]);
+    return query_print(q);
+  }
+  if (word)
+    return filter_view(word);
+
+  if (act != 'D')
+    render_load();
+  hist_load();
+  state_open();
+  content_watch();
+  term_open();
+  atexit(term_restore);
+  fb_append(CUR_HIDE);
+  fb_flush();
+
+  /* -s важнее сохранённой сессии */
+  int resume = open_sec < 0 ? menu_item(state_sec(state->open)) : -1;
+  int items = menu_items();
+  int cur = open_sec >= 0 ? menu_item(open_sec)
+            : resume >= 0 ? resume
+                          : menu_item(state_sec(state->menu));
+  int last_g = 0;
+
+  if (cur < 0)
+    cur = 0;
+  if (open_sec >= 0 || resume >= 0)
+    menu_open(cur);
+
+  while (1) {
+    state->menu = state_id(menu_sec(cur));
+    print_menu(cur);
+    menu_hover(cur);
+    int key = read_key();
+
+    if (key == 'j') {
+      if (cur < items - 1)
+        cur++;
+      last_g = 0;
+    } else if (key == 'k') {
+      if (cur > 0)
+        cur--;
+      last_g = 0;
+    } else if (key == 'g') {
+      if (last_g) {
+        cur = 0;
+        last_g = 0;
+      } else
+        last_g = 1;
+    } else if (key == 'G') {
+      cur = items - 1;
+      last_g = 0;
+    } else if (key == '%') {
+      cur = (cur == 0) ? items - 1 : 0;
+      last_g = 0;
+    } else if (key == 'l' || key == '\r' || key == '\n') {
+      menu_open(cur);
+      last_g = 0;
+    } else if (key == '0' && recent_n > 0) {
+      cur = 0;
+      menu_open(cur);
+      last_g = 0;
+    } else if (key >= '1' && key <= '0' + (nsections < 9 ? nsections : 9)) {
+      cur = key - '1' + (recent_n > 0);
+      menu_open(cur);
+      last_g = 0;
+    } else if (key == '\t') {
+      tutor_switch((tutor_idx + 1) % TUTORS_N);
+      items = menu_items();
+      cur = menu_item(state_sec(state->menu));
+      if (cur < 0)
+        cur = 0;
+      last_g = 0;
+    } else if (key == KEY_RELOAD) {
+      content_reload();
+      items = menu_items();
+      if (cur >= items)
+        cur = items - 1;
+    } else if (key == 'q' || key == 'x' || key == -1) {
+      break;
+    } else {
+      last_g = 0;
+    }
+  }
+
+  hist_close();
+  render_save();
+  state_close();
+  term_close();
+
+  fb_reset();
+  fb_append(C_HINT "\n  bye\n\n" RESET);
+  fb_flush();
+  free(fbuf);
+  return 0;
+}
+
+#endif /* TUTOR_GENKEYS */
@@ -0,0 +1,47 @@
+/* tutor.h — общее для движка и пакетов контента */
+#ifndef TUTOR_H
+#define TUTOR_H
+
+#include <stddef.h>
+
+/* ── ANSI ───────────────────────────────────────────────────────────── */
+#define RESET "\033[0m"
+#define BOLD "\033[1m"
+#define DIM "\033[2m"
+#define CUR_HIDE "\033[?25l"
+#define CUR_SHOW "\033[?25h"
+#define CLR "\033[2J\033[H"
+#define ALT_ON "\033[?1049h"
+#define ALT_OFF "\033[?1049l"
+
+#define C_KEY "\033[38;5;183m"
+#define C_DESC "\033[38;5;252m"
+#define C_HEAD "\033[38;5;150m"
+#define C_SEP "\033[38;5;240m"
+#define C_HINT "\033[38;5;109m"
+#define C_CUR "\033[48;5;237m\033[38;5;255m"
+#define C_CODE "\033[38;5;222m"
+
+/* ── tutor ──────────────────────────────────────────────────────────── */
+/* Шпаргалка целиком: секции, меню, баннер. Движок один (tutor.c),
+   шпаргалки — git.c, zsh.c, nvim.c; какую показывать, решает argv[0]
+   или -t, Tab в меню переключает на следующую. */
+typedef struct {
+  const char *name;  /* gitutor: имя бинаря, лога, каталога контента */
+  const char *alias; /* git: для -t */
+  const char *title; /* цвет T:-строк */
+  int key_w;         /* ширина колонки key в R:-строках */
+  int n;             /* встроенных секций */
+  const char *const *labels;
+  const char *const *ids;
+  const char **const *sections;
+  const char *banner;
+  /* Enter на R:-строке: sh-скрипт, $1 — ключ, stdout — страница;
+     detail_tool — чей бинарь версионирует кэш (NULL — первое слово) */
+  const char *detail;
+  const char *detail_tool;
+} Tutor;
+
+extern const Tutor tutor_git, tutor_zsh, tutor_nvim;
+
+#endif /* TUTOR_H */